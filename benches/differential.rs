@@ -0,0 +1,206 @@
+//! Differential regression harness: every optimized coding/transform path
+//! against its reference path on one deterministic corpus, asserting
+//! byte-identical output and reporting relative speed.
+//!
+//! The repo carries the upstream C++ sources (`src/asm/ZPCodec.cpp`,
+//! `src/encode/iw44/filters.cpp`) for reference, but they depend on
+//! DjVuLibre headers that are not vendored, so this target pins the port to
+//! embedded golden hashes instead: the expected stream/plane digests below
+//! were captured from the per-bit, two-pass code paths whose output has been
+//! verified against the C++ implementation. A divergence in any variant —
+//! or in the reference itself after an upgrade — fails here in seconds.
+//!
+//! Run with `cargo bench --bench differential`.
+
+use std::io::Cursor;
+use std::time::Instant;
+
+use djvu_encoder::encode::iw44::transform::{Encode, StripTransform};
+use djvu_encoder::encode::zc::ZEncoder;
+
+const WARMUP: usize = 2;
+const SAMPLES: usize = 5;
+
+/// FNV-1a over a byte stream, matching the golden tests in `zcodec.rs`.
+fn fnv1a(data: &[u8]) -> u64 {
+    let mut hash = 0xcbf29ce484222325u64;
+    for &b in data {
+        hash = (hash ^ b as u64).wrapping_mul(0x100000001b3);
+    }
+    hash
+}
+
+fn fnv1a_i16(data: &[i16]) -> u64 {
+    let mut hash = 0xcbf29ce484222325u64;
+    for &v in data {
+        hash = (hash ^ (v as u16 as u64)).wrapping_mul(0x100000001b3);
+    }
+    hash
+}
+
+/// Times `f` and returns (median ns, result of the last run).
+fn time<T>(mut f: impl FnMut() -> T) -> (u128, T) {
+    for _ in 0..WARMUP {
+        f();
+    }
+    let mut ns: Vec<u128> = Vec::with_capacity(SAMPLES);
+    let mut out = None;
+    for _ in 0..SAMPLES {
+        let t = Instant::now();
+        let r = f();
+        ns.push(t.elapsed().as_nanos());
+        out = Some(r);
+    }
+    ns.sort_unstable();
+    (ns[SAMPLES / 2], out.unwrap())
+}
+
+fn report(name: &str, bits: usize, ns: u128, base_ns: u128) {
+    println!(
+        "{name:<46} {:>7.2} ns/bit  {:>5.2}x vs reference",
+        ns as f64 / bits as f64,
+        base_ns as f64 / ns as f64,
+    );
+}
+
+struct Lcg(u64);
+impl Lcg {
+    fn next(&mut self) -> u64 {
+        self.0 = self
+            .0
+            .wrapping_mul(6364136223846793005)
+            .wrapping_add(1442695040888963407);
+        self.0
+    }
+}
+
+/// Adaptive trace: bit pairs with a first context and a data-dependent
+/// second context, the shape `encode2` accelerates.
+fn zp_adaptive() {
+    const PAIRS: usize = 1 << 19;
+    let mut rng = Lcg(0xd1f7);
+    let trace: Vec<(bool, bool, usize)> = (0..PAIRS)
+        .map(|_| {
+            let x = rng.next();
+            ((x >> 60) < 5, (x >> 55) & 1 != 0, ((x >> 8) & 15) as usize)
+        })
+        .collect();
+
+    let run_reference = || {
+        let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+        let mut c0 = [0u8; 16];
+        let mut c1a = [0u8; 16];
+        let mut c1b = [0u8; 16];
+        for &(b0, b1, i) in &trace {
+            enc.encode(b0, &mut c0[i]).unwrap();
+            let c1 = if b0 { &mut c1b[i] } else { &mut c1a[i] };
+            enc.encode(b1, c1).unwrap();
+        }
+        enc.finish().unwrap().into_inner()
+    };
+    let run_paired = || {
+        let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+        let mut c0 = [0u8; 16];
+        let mut c1a = [0u8; 16];
+        let mut c1b = [0u8; 16];
+        for &(b0, b1, i) in &trace {
+            enc.encode2(b0, &mut c0[i], b1, &mut c1a[i], &mut c1b[i]).unwrap();
+        }
+        enc.finish().unwrap().into_inner()
+    };
+
+    let (ref_ns, reference) = time(run_reference);
+    let (pair_ns, paired) = time(run_paired);
+    assert_eq!(reference, paired, "encode2 diverged from per-bit encode");
+    assert_eq!(
+        (reference.len(), fnv1a(&reference)),
+        (129016, 0x8301513007f1b618),
+        "adaptive reference stream changed"
+    );
+    report("zp adaptive per-bit encode (reference)", PAIRS * 2, ref_ns, ref_ns);
+    report("zp adaptive encode2", PAIRS * 2, pair_ns, ref_ns);
+}
+
+/// Pass-thru trace: the significance-bit bursts IW44 bucket coding emits.
+fn zp_passthru() {
+    const N: usize = 1 << 21;
+    let mut rng = Lcg(0xbeef);
+    let bits: Vec<bool> = (0..N).map(|_| (rng.next() >> 58) < 9).collect();
+
+    let run_reference = || {
+        let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+        for &b in &bits {
+            enc.encode_raw(b).unwrap();
+        }
+        enc.finish().unwrap().into_inner()
+    };
+    let run_batched = || {
+        let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+        for chunk in bits.chunks(48) {
+            enc.iwencode_run(chunk).unwrap();
+        }
+        enc.finish().unwrap().into_inner()
+    };
+
+    let (ref_ns, reference) = time(run_reference);
+    let (run_ns, batched) = time(run_batched);
+    assert_eq!(reference, batched, "iwencode_run diverged from encode_raw");
+    assert_eq!(
+        (reference.len(), fnv1a(&reference)),
+        (262144, 0xacb265e2f1daac4e),
+        "pass-thru reference stream changed"
+    );
+    report("zp pass-thru per-bit (reference)", N, ref_ns, ref_ns);
+    report("zp pass-thru iwencode_run x48", N, run_ns, ref_ns);
+}
+
+/// Forward transform: split passes (reference order) against the fused,
+/// saturating and strip-based variants on the same plane.
+fn transform() {
+    const W: usize = 2048;
+    const H: usize = 1536;
+    const LEVELS: usize = 5;
+    let mut rng = Lcg(0x1f44);
+    let plane: Vec<i16> = (0..W * H).map(|_| ((rng.next() >> 48) as i16) >> 6).collect();
+    let bits = W * H * 16;
+
+    let run = |f: &dyn Fn(&mut [i16])| {
+        let mut buf = plane.clone();
+        f(&mut buf);
+        buf
+    };
+
+    let (ref_ns, reference) = time(|| run(&|b| Encode::forward(b, W, H, W, LEVELS)));
+    let (fused_ns, fused) = time(|| run(&|b| Encode::forward_fused(b, W, H, W, LEVELS)));
+    let (sat_ns, sat) = time(|| run(&|b| Encode::forward_saturating(b, W, H, W, LEVELS)));
+    let (strip_ns, strip) = time(|| {
+        let mut out = vec![0i16; W * H];
+        let mut st = StripTransform::new(W, H, LEVELS, 256);
+        let mut sink = |y: usize, row: &[i16]| out[y * W..y * W + W].copy_from_slice(row);
+        for y in 0..H {
+            st.push_row(&plane[y * W..y * W + W], &mut sink);
+        }
+        st.finish(&mut sink);
+        out
+    });
+
+    assert_eq!(reference, fused, "fused transform diverged");
+    assert_eq!(reference, sat, "saturating transform diverged on in-range input");
+    assert_eq!(reference, strip, "strip transform diverged");
+    assert_eq!(
+        fnv1a_i16(&reference),
+        0x0ae6f82693761ba7,
+        "transform reference plane changed"
+    );
+    report("iw44 forward split passes (reference)", bits, ref_ns, ref_ns);
+    report("iw44 forward_fused", bits, fused_ns, ref_ns);
+    report("iw44 forward_saturating", bits, sat_ns, ref_ns);
+    report("iw44 strip transform", bits, strip_ns, ref_ns);
+}
+
+fn main() {
+    zp_adaptive();
+    zp_passthru();
+    transform();
+    println!("all differential checks passed");
+}
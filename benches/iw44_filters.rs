@@ -0,0 +1,84 @@
+//! IW44 lifting filter microbenchmarks on 1K/4K/16K-wide planes.
+//!
+//! Run with `cargo bench --bench iw44_filters` (add `--features rayon` to
+//! exercise the parallel dispatch inside `forward`). The per-pass split for
+//! `filter_fh`/`filter_fv` comes from `forward_with_stats`, so the numbers
+//! map directly onto the production counters.
+
+use std::time::Instant;
+
+use djvu_encoder::encode::iw44::transform::{Encode, TransformStats};
+
+const WARMUP: usize = 2;
+const SAMPLES: usize = 5;
+
+fn plane(w: usize, h: usize, seed: u64) -> Vec<i16> {
+    let mut state = seed | 1;
+    (0..w * h)
+        .map(|_| {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            (state as i16) >> 4
+        })
+        .collect()
+}
+
+/// Median MB/s over `SAMPLES` runs of `f`, each starting from a fresh copy
+/// of `src`; `bytes` is the traffic one run generates.
+fn bench(name: &str, src: &[i16], bytes: usize, mut f: impl FnMut(&mut [i16])) {
+    let mut buf = src.to_vec();
+    for _ in 0..WARMUP {
+        buf.copy_from_slice(src);
+        f(&mut buf);
+    }
+    let mut ns: Vec<u128> = (0..SAMPLES)
+        .map(|_| {
+            buf.copy_from_slice(src);
+            let t = Instant::now();
+            f(&mut buf);
+            t.elapsed().as_nanos()
+        })
+        .collect();
+    ns.sort_unstable();
+    let med = ns[SAMPLES / 2];
+    let mbps = bytes as f64 / (med as f64 / 1e9) / 1e6;
+    println!(
+        "{name:<38} {:>8.2} ms {mbps:>9.2} MB/s  (spread {:.2}..{:.2} ms)",
+        med as f64 / 1e6,
+        ns[0] as f64 / 1e6,
+        ns[SAMPLES - 1] as f64 / 1e6,
+    );
+}
+
+fn main() {
+    // Widths from the request; heights sized to keep the largest plane at
+    // 16 MB so the suite runs on any builder.
+    for &(w, h) in &[(1024usize, 1024usize), (4096, 1024), (16384, 512)] {
+        let src = plane(w, h, (w as u64) << 16 | 0xabcd);
+        let levels = 5;
+        let bytes = 2 * w * h;
+
+        bench(&format!("forward {w}x{h} (5 levels)"), &src, bytes * levels, |buf| {
+            Encode::forward(buf, w, h, w, levels);
+        });
+        bench(&format!("forward_fused {w}x{h} (5 levels)"), &src, bytes * levels, |buf| {
+            Encode::forward_fused(buf, w, h, w, levels);
+        });
+
+        // Single level split into the two passes via the stats counters.
+        let mut buf = src.clone();
+        let mut stats = TransformStats::default();
+        for _ in 0..WARMUP + 1 {
+            buf.copy_from_slice(&src);
+            stats.scales.clear();
+            Encode::forward_with_stats(&mut buf, w, h, w, 1, &mut stats);
+        }
+        let s = &stats.scales[0];
+        println!(
+            "  scale 1 split: filter_fh {:>7.2} ms, filter_fv {:>7.2} ms",
+            s.fh.as_secs_f64() * 1e3,
+            s.fv.as_secs_f64() * 1e3,
+        );
+    }
+}
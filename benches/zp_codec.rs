@@ -0,0 +1,83 @@
+//! ZP coder microbenchmarks: adaptive coding at several context
+//! predictability levels, the pass-thru path, and the batched IW44 run API.
+//!
+//! Run with `cargo bench --bench zp_codec`. Plain `Instant` timing — no
+//! external harness — so the numbers are comparable across toolchains.
+
+use std::io::Cursor;
+use std::time::Instant;
+
+use djvu_encoder::encode::zc::ZEncoder;
+
+const WARMUP: usize = 2;
+const SAMPLES: usize = 7;
+
+/// Runs `f` with warmup, then reports the median ns/bit and MB/s over
+/// `SAMPLES` timed repetitions plus the min..max spread.
+fn bench(name: &str, bits: usize, mut f: impl FnMut()) {
+    for _ in 0..WARMUP {
+        f();
+    }
+    let mut ns: Vec<u128> = (0..SAMPLES)
+        .map(|_| {
+            let t = Instant::now();
+            f();
+            t.elapsed().as_nanos()
+        })
+        .collect();
+    ns.sort_unstable();
+    let med = ns[SAMPLES / 2];
+    let ns_per_bit = med as f64 / bits as f64;
+    let mbps = (bits as f64 / 8.0) / (med as f64 / 1e9) / 1e6;
+    println!(
+        "{name:<42} {ns_per_bit:>7.2} ns/bit {mbps:>8.2} MB/s  (spread {:.2}..{:.2} ns/bit)",
+        ns[0] as f64 / bits as f64,
+        ns[SAMPLES - 1] as f64 / bits as f64,
+    );
+}
+
+/// Deterministic bit stream where a one appears with probability
+/// `ones_per_256 / 256` — the knob for context predictability.
+fn bit_stream(n: usize, ones_per_256: u32, seed: u64) -> Vec<bool> {
+    let mut state = seed;
+    (0..n)
+        .map(|_| {
+            state = state.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+            ((state >> 56) as u32) < ones_per_256
+        })
+        .collect()
+}
+
+fn main() {
+    const N: usize = 1 << 20;
+
+    // Adaptive coding: context predictability from coin-flip to near-certain.
+    for &(label, ones) in &[("p(1)=0.50", 128u32), ("p(1)=0.10", 26), ("p(1)=0.01", 3)] {
+        let bits = bit_stream(N, ones, 0x5eed);
+        bench(&format!("adaptive encode {label}"), N, || {
+            let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+            let mut ctxs = [0u8; 16];
+            for (i, &b) in bits.iter().enumerate() {
+                enc.encode(b, &mut ctxs[i & 15]).unwrap();
+            }
+            enc.finish().unwrap();
+        });
+    }
+
+    // Pass-thru path (IW44 significance bits), per-bit and batched.
+    let bits = bit_stream(N, 64, 0xfeed);
+    bench("pass-thru iwencoder per bit", N, || {
+        let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+        for &b in &bits {
+            enc.iwencoder(b).unwrap();
+        }
+        enc.finish().unwrap();
+    });
+    bench("pass-thru iwencode_run x32", N, || {
+        let mut enc = ZEncoder::new_const::<true>(Cursor::new(Vec::new())).unwrap();
+        for run in bits.chunks(32) {
+            enc.iwencode_run(run).unwrap();
+        }
+        enc.finish().unwrap();
+    });
+}
@@ -691,3 +691,264 @@ zpcodec_eflush:
 global _zpcodec_eflush
 _zpcodec_eflush:
     jmp zpcodec_eflush
+
+; Fused full-encoder hot path
+
+section .text
+global zpcodec_encode_bit
+
+; ============================================================================
+; encode_bit - full encoder step: context load, interval update, adaptation,
+;              inline bit emission. The emission helpers below skip the
+;              per-bit debug hook, so a renormalized bit never leaves this
+;              module (bytestream_write still runs once per completed byte).
+;   rdi = ZPCodec* self, rsi = BitContext* ctx, edx = int bit
+; ============================================================================
+zpcodec_encode_bit:
+    push    rbp
+    mov     rbp, rsp
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    sub     rsp, 8           ; maintain 16-byte alignment before calls
+
+    mov     r12, rdi         ; Save self pointer
+    mov     r13, rsi         ; Save ctx pointer
+    mov     r14d, edx        ; Save bit
+    and     r14d, 1
+
+    ; Load context, compute z = a + p[ctx] (p table at offset 32)
+    movzx   ebx, byte [r13]
+    mov     eax, [r12 + 4]   ; Load a
+    lea     rcx, [r12 + 32]
+    add     eax, [rcx + rbx*4] ; eax = z
+
+    ; LPS when the coded bit differs from the context MPS bit
+    mov     ecx, ebx
+    and     ecx, 1
+    cmp     ecx, r14d
+    jne     .lps
+
+    ; MPS fast path: no renormalization pending, just update a
+    cmp     eax, 0x8000
+    jae     .mps_slow
+    mov     [r12 + 4], eax
+    jmp     .exit
+
+.mps_slow:
+    ; Interval reversion (z >= 0x8000 on this branch)
+    shr     eax, 1
+    add     eax, 0x4000      ; z = 0x4000 + (z >> 1)
+
+    ; Adaptation: if (a >= m[ctx]) ctx = up[ctx]
+    mov     ecx, [r12 + 4]   ; a before update
+    lea     rdx, [r12 + 1056]
+    cmp     ecx, [rdx + rbx*4]
+    jb      .mps_store
+    lea     rdx, [r12 + 2080]
+    movzx   ebx, byte [rdx + rbx]
+    mov     byte [r13], bl
+.mps_store:
+    mov     [r12 + 4], eax   ; a = z
+    jmp     .export
+
+.lps:
+    ; Interval reversion: if (z >= 0x8000) z = 0x4000 + (z >> 1)
+    cmp     eax, 0x8000
+    jb      .lps_no_revert
+    shr     eax, 1
+    add     eax, 0x4000
+.lps_no_revert:
+    ; Adaptation: ctx = dn[ctx]
+    lea     rdx, [r12 + 2336]
+    movzx   ecx, byte [rdx + rbx]
+    mov     byte [r13], cl
+
+    ; z = 0x10000 - z; subend += z; a += z
+    mov     ecx, 0x10000
+    sub     ecx, eax
+    add     [r12 + 8], ecx
+    add     [r12 + 4], ecx
+
+    ; Export bits: while (a >= 0x8000)
+.export:
+    mov     eax, [r12 + 4]   ; Load a
+    cmp     eax, 0x8000
+    jb      .exit
+
+    ; zemit(1 - (subend>>15)) without the debug hook
+    mov     ecx, [r12 + 8]   ; Load subend
+    shr     ecx, 15
+    xor     esi, esi
+    test    ecx, ecx
+    setz    sil
+    mov     rdi, r12
+    call    zpcodec_zemit_raw
+
+    ; subend = (subend << 1)
+    mov     eax, [r12 + 8]
+    shl     eax, 1
+    and     eax, 0xffff      ; Keep as unsigned short
+    mov     [r12 + 8], eax
+
+    ; a = (a << 1)
+    mov     eax, [r12 + 4]
+    shl     eax, 1
+    and     eax, 0xffff      ; Keep as unsigned short
+    mov     [r12 + 4], eax
+
+    jmp     .export
+
+.exit:
+    add     rsp, 8
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    pop     rbp
+    ret
+
+; macOS symbol
+global _zpcodec_encode_bit
+_zpcodec_encode_bit:
+    jmp zpcodec_encode_bit
+
+; ============================================================================
+; zemit_raw - zemit without the per-bit debug hook (module-internal)
+; ============================================================================
+zpcodec_zemit_raw:
+    push    rbp
+    mov     rbp, rsp
+    push    rbx
+    push    r12
+    push    r13
+    sub     rsp, 8           ; maintain 16-byte alignment before calls
+
+    mov     r12, rdi         ; Save self pointer
+    mov     r13d, esi        ; Save input bit
+
+    ; buffer = (buffer << 1) + b
+    mov     eax, [r12 + 12]
+    shl     eax, 1
+    add     eax, r13d
+    mov     ebx, eax
+    shr     ebx, 24          ; Extract bit 24
+    and     eax, 0xffffff
+    mov     [r12 + 12], eax
+
+    cmp     ebx, 1
+    je      .case_one
+    cmp     ebx, 0xff
+    je      .case_ff
+    test    ebx, ebx
+    jz      .case_zero
+
+    ; Invalid state fallback: central renormalization
+    inc     dword [r12 + 16]
+    jmp     .exit
+
+.case_one:
+    ; Upper renormalization: emit 1, then nrun 0s
+    mov     rdi, r12
+    mov     esi, 1
+    call    zpcodec_outbit_raw
+    mov     r13d, [r12 + 16]
+    test    r13d, r13d
+    jz      .done_ones
+.emit_zeros_loop:
+    mov     rdi, r12
+    xor     esi, esi
+    call    zpcodec_outbit_raw
+    dec     r13d
+    jnz     .emit_zeros_loop
+.done_ones:
+    mov     dword [r12 + 16], 0
+    jmp     .exit
+
+.case_ff:
+    ; Lower renormalization: emit 0, then nrun 1s
+    mov     rdi, r12
+    xor     esi, esi
+    call    zpcodec_outbit_raw
+    mov     r13d, [r12 + 16]
+    test    r13d, r13d
+    jz      .done_ff
+.emit_ones_loop:
+    mov     rdi, r12
+    mov     esi, 1
+    call    zpcodec_outbit_raw
+    dec     r13d
+    jnz     .emit_ones_loop
+.done_ff:
+    mov     dword [r12 + 16], 0
+    jmp     .exit
+
+.case_zero:
+    inc     dword [r12 + 16]     ; nrun++
+
+.exit:
+    add     rsp, 8
+    pop     r13
+    pop     r12
+    pop     rbx
+    pop     rbp
+    ret
+
+; ============================================================================
+; outbit_raw - outbit without the per-bit debug hook (module-internal)
+; ============================================================================
+zpcodec_outbit_raw:
+    push    rbp
+    mov     rbp, rsp
+    push    rbx
+    push    r12
+    sub     rsp, 16          ; Align stack to 16 bytes
+
+    mov     r12, rdi         ; Save self pointer
+    mov     ebx, esi         ; Save bit value
+
+    ; Delay window
+    movzx   eax, byte [r12 + 2]
+    test    eax, eax
+    jz      .emit_bit
+    cmp     al, 0xff
+    je      .exit            ; delay == 0xff: suspended forever
+    dec     al
+    mov     byte [r12 + 2], al
+    jmp     .exit
+
+.emit_bit:
+    ; byte = (byte << 1) | bit
+    movzx   eax, byte [r12 + 0]
+    shl     al, 1
+    and     ebx, 1
+    or      al, bl
+    mov     byte [r12 + 0], al
+
+    ; scount++
+    movzx   ecx, byte [r12 + 1]
+    inc     ecx
+    mov     byte [r12 + 1], cl
+    cmp     cl, 8
+    jne     .exit
+
+    ; Full byte: require encoding mode, then bytestream_write(bs, &byte, 1)
+    movzx   edx, byte [r12 + 3]
+    test    edx, edx
+    jz      .exit
+    mov     rdi, [r12 + 24]
+    lea     rsi, [r12 + 0]
+    mov     rdx, 1
+    call    bytestream_write
+    cmp     rax, 1
+    jne     .exit
+    mov     byte [r12 + 1], 0    ; scount = 0
+    mov     byte [r12 + 0], 0    ; byte = 0
+
+.exit:
+    add     rsp, 16
+    pop     r12
+    pop     rbx
+    pop     rbp
+    ret
@@ -0,0 +1,455 @@
+// DjVu ZPCodec encoder (AArch64, GNU as)
+// Mirror of zpcodec_fixed.asm for ARM targets; same entry points, same
+// ZpAsmState layout.
+// Field offsets (repr C): byte=0 scount=1 delay=2 encoding=3 a=4 subend=8
+//                         buffer=12 nrun=16 bs(ptr)=24
+// Tables: p@32, m@1056, up@2080, dn@2336
+//
+// AAPCS64: x0 = ZPCodec* self, then w1/x1/w2 per entry point, matching the
+// SysV order used by the x86-64 file.
+
+    .text
+
+// ============================================================================
+// zpcodec_einit - reset coder registers
+// ============================================================================
+    .globl zpcodec_einit
+    .p2align 2
+zpcodec_einit:
+    str     wzr, [x0, 4]            // a = 0
+    strb    wzr, [x0, 1]            // scount = 0
+    strb    wzr, [x0, 0]            // byte = 0
+    mov     w9, #25
+    strb    w9, [x0, 2]             // delay = 25
+    str     wzr, [x0, 8]            // subend = 0
+    mov     w9, #0xffff
+    movk    w9, #0x00ff, lsl #16    // w9 = 0x00ffffff
+    str     w9, [x0, 12]            // buffer = 0xffffff
+    str     wzr, [x0, 16]           // nrun = 0
+    ret
+
+    .globl _zpcodec_einit
+_zpcodec_einit:
+    b       zpcodec_einit
+
+// ============================================================================
+// zpcodec_zemit - push one code bit through the carry buffer
+//   x0 = self, w1 = b
+// ============================================================================
+    .globl zpcodec_zemit
+    .p2align 2
+zpcodec_zemit:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+
+    mov     x19, x0                 // self
+    mov     w20, w1                 // input bit
+
+    // Debug: log state at zemit entry (event=2)
+    mov     w0, #2
+    ldr     w1, [x19, 4]            // a
+    ldr     w2, [x19, 8]            // subend
+    ldr     w3, [x19, 12]           // buffer
+    ldr     w4, [x19, 16]           // nrun
+    and     w5, w20, #1
+    bl      zp_debug_hook
+
+    // buffer = (buffer << 1) + b; extract and mask bit 24
+    ldr     w9, [x19, 12]
+    lsl     w9, w9, #1
+    add     w9, w9, w20
+    lsr     w10, w9, #24            // outgoing byte-marker bits
+    and     w9, w9, #0x00ffffff
+    str     w9, [x19, 12]
+
+    cmp     w10, #1
+    b.eq    .Lzemit_one
+    cmp     w10, #0xff
+    b.eq    .Lzemit_ff
+    cbz     w10, .Lzemit_zero
+
+    // Invalid state: treat as central renormalization (matches x86 fallback)
+    ldr     w9, [x19, 16]
+    add     w9, w9, #1
+    str     w9, [x19, 16]
+    b       .Lzemit_exit
+
+.Lzemit_one:
+    // Upper renormalization: emit 1, then nrun 0s
+    mov     x0, x19
+    mov     w1, #1
+    bl      zpcodec_outbit
+    ldr     w20, [x19, 16]          // nrun
+    cbz     w20, .Lzemit_one_done
+.Lzemit_zero_loop:
+    mov     x0, x19
+    mov     w1, wzr
+    bl      zpcodec_outbit
+    subs    w20, w20, #1
+    b.ne    .Lzemit_zero_loop
+.Lzemit_one_done:
+    str     wzr, [x19, 16]          // nrun = 0
+    b       .Lzemit_exit
+
+.Lzemit_ff:
+    // Lower renormalization: emit 0, then nrun 1s
+    mov     x0, x19
+    mov     w1, wzr
+    bl      zpcodec_outbit
+    ldr     w20, [x19, 16]          // nrun
+    cbz     w20, .Lzemit_ff_done
+.Lzemit_one_loop:
+    mov     x0, x19
+    mov     w1, #1
+    bl      zpcodec_outbit
+    subs    w20, w20, #1
+    b.ne    .Lzemit_one_loop
+.Lzemit_ff_done:
+    str     wzr, [x19, 16]          // nrun = 0
+    b       .Lzemit_exit
+
+.Lzemit_zero:
+    // Central renormalization: nrun++
+    ldr     w9, [x19, 16]
+    add     w9, w9, #1
+    str     w9, [x19, 16]
+
+.Lzemit_exit:
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+    .globl _zpcodec_zemit
+_zpcodec_zemit:
+    b       zpcodec_zemit
+
+// ============================================================================
+// zpcodec_outbit - append one bit to the output byte, write on boundary
+//   x0 = self, w1 = bit
+// ============================================================================
+    .globl zpcodec_outbit
+    .p2align 2
+zpcodec_outbit:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+
+    mov     x19, x0                 // self
+    mov     w20, w1                 // bit
+
+    // Debug: log state before processing the bit (event=1)
+    mov     w0, #1
+    ldr     w1, [x19, 4]            // a
+    ldr     w2, [x19, 8]            // subend
+    ldr     w3, [x19, 12]           // buffer
+    ldr     w4, [x19, 16]           // nrun
+    and     w5, w20, #1
+    bl      zp_debug_hook
+
+    // Delay window
+    ldrb    w9, [x19, 2]
+    cbz     w9, .Loutbit_emit
+    cmp     w9, #0xff
+    b.eq    .Loutbit_exit           // delay == 0xff: suspended forever
+    sub     w9, w9, #1
+    strb    w9, [x19, 2]
+    b       .Loutbit_exit
+
+.Loutbit_emit:
+    // byte = (byte << 1) | bit
+    ldrb    w9, [x19, 0]
+    lsl     w9, w9, #1
+    and     w10, w20, #1
+    orr     w9, w9, w10
+    strb    w9, [x19, 0]
+
+    // scount++
+    ldrb    w10, [x19, 1]
+    add     w10, w10, #1
+    strb    w10, [x19, 1]
+    cmp     w10, #8
+    b.ne    .Loutbit_exit
+
+    // Full byte: require encoding mode, then bytestream_write(bs, &byte, 1)
+    ldrb    w11, [x19, 3]
+    cbz     w11, .Loutbit_exit
+    ldr     x0, [x19, 24]           // bs
+    mov     x1, x19                 // &byte (offset 0)
+    mov     x2, #1
+    bl      bytestream_write
+    // Return value checked like x86: errors fall through to the reset
+    strb    wzr, [x19, 1]           // scount = 0
+    strb    wzr, [x19, 0]           // byte = 0
+
+.Loutbit_exit:
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+    .globl _zpcodec_outbit
+_zpcodec_outbit:
+    b       zpcodec_outbit
+
+// ============================================================================
+// Renormalization shift engine shared by the encode entry points:
+// emits while (a >= 0x8000) { zemit(1 - (subend>>15)); subend <<= 1; a <<= 1; }
+// Callee: x19 = self (caller-saved registers are clobbered).
+// ============================================================================
+    .p2align 2
+.Lexport_bits:
+    stp     x29, x30, [sp, #-16]!
+    mov     x29, sp
+.Lexport_loop:
+    ldr     w9, [x19, 4]            // a
+    mov     w10, #0x8000
+    cmp     w9, w10
+    b.lo    .Lexport_done
+    ldr     w11, [x19, 8]           // subend
+    lsr     w11, w11, #15
+    cmp     w11, #0
+    cset    w1, eq                  // 1 - (subend >> 15)
+    mov     x0, x19
+    bl      zpcodec_zemit
+    ldr     w9, [x19, 8]
+    lsl     w9, w9, #1
+    and     w9, w9, #0xffff
+    str     w9, [x19, 8]            // subend = (u16)(subend << 1)
+    ldr     w9, [x19, 4]
+    lsl     w9, w9, #1
+    and     w9, w9, #0xffff
+    str     w9, [x19, 4]            // a = (u16)(a << 1)
+    b       .Lexport_loop
+.Lexport_done:
+    ldp     x29, x30, [sp], #16
+    ret
+
+// ============================================================================
+// zpcodec_encode_mps - x0 = self, x1 = ctx, w2 = z
+// ============================================================================
+    .globl zpcodec_encode_mps
+    .p2align 2
+zpcodec_encode_mps:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+
+    mov     x19, x0
+    mov     x20, x1
+
+    // Interval reversion: if (z >= 0x8000) z = 0x4000 + (z >> 1)
+    mov     w10, #0x8000
+    cmp     w2, w10
+    b.lo    1f
+    lsr     w9, w2, #1
+    mov     w10, #0x4000
+    add     w2, w9, w10
+1:
+    // Adaptation: if (a >= m[ctx]) ctx = up[ctx]
+    ldrb    w9, [x20]               // *ctx
+    ldr     w10, [x19, 4]           // a
+    add     x11, x19, #1056         // m table
+    ldr     w12, [x11, w9, uxtw #2]
+    cmp     w10, w12
+    b.lo    2f
+    add     x11, x19, #2080         // up table
+    ldrb    w9, [x11, w9, uxtw]
+    strb    w9, [x20]
+2:
+    str     w2, [x19, 4]            // a = z
+    bl      .Lexport_bits
+
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+// ============================================================================
+// zpcodec_encode_lps - x0 = self, x1 = ctx, w2 = z
+// ============================================================================
+    .globl zpcodec_encode_lps
+    .p2align 2
+zpcodec_encode_lps:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+
+    mov     x19, x0
+    mov     x20, x1
+
+    // Interval reversion: if (z >= 0x8000) z = 0x4000 + (z >> 1)
+    mov     w10, #0x8000
+    cmp     w2, w10
+    b.lo    1f
+    lsr     w9, w2, #1
+    mov     w10, #0x4000
+    add     w2, w9, w10
+1:
+    // Adaptation: ctx = dn[ctx]
+    ldrb    w9, [x20]
+    add     x11, x19, #2336         // dn table
+    ldrb    w9, [x11, w9, uxtw]
+    strb    w9, [x20]
+
+    // z = 0x10000 - z; subend += z; a += z
+    mov     w9, #1
+    lsl     w9, w9, #16
+    sub     w2, w9, w2
+    ldr     w9, [x19, 8]
+    add     w9, w9, w2
+    str     w9, [x19, 8]
+    ldr     w9, [x19, 4]
+    add     w9, w9, w2
+    str     w9, [x19, 4]
+    bl      .Lexport_bits
+
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+    .globl _zpcodec_encode_mps
+_zpcodec_encode_mps:
+    b       zpcodec_encode_mps
+
+    .globl _zpcodec_encode_lps
+_zpcodec_encode_lps:
+    b       zpcodec_encode_lps
+
+// ============================================================================
+// zpcodec_encode_mps_simple - x0 = self, w1 = z (pass-thru, no adaptation)
+// ============================================================================
+    .globl zpcodec_encode_mps_simple
+    .p2align 2
+zpcodec_encode_mps_simple:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    str     x19, [sp, #16]
+
+    mov     x19, x0
+    str     w1, [x19, 4]            // a = z
+    bl      .Lexport_bits
+
+    ldr     x19, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+// ============================================================================
+// zpcodec_encode_lps_simple - x0 = self, w1 = z (pass-thru, no adaptation)
+// ============================================================================
+    .globl zpcodec_encode_lps_simple
+    .p2align 2
+zpcodec_encode_lps_simple:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    str     x19, [sp, #16]
+
+    mov     x19, x0
+
+    // z = 0x10000 - z; subend += z; a += z
+    mov     w9, #1
+    lsl     w9, w9, #16
+    sub     w1, w9, w1
+    ldr     w9, [x19, 8]
+    add     w9, w9, w1
+    str     w9, [x19, 8]
+    ldr     w9, [x19, 4]
+    add     w9, w9, w1
+    str     w9, [x19, 4]
+    bl      .Lexport_bits
+
+    ldr     x19, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+    .globl _zpcodec_encode_mps_simple
+_zpcodec_encode_mps_simple:
+    b       zpcodec_encode_mps_simple
+
+    .globl _zpcodec_encode_lps_simple
+_zpcodec_encode_lps_simple:
+    b       zpcodec_encode_lps_simple
+
+// ============================================================================
+// zpcodec_eflush - terminate the stream
+//   x0 = self
+// ============================================================================
+    .globl zpcodec_eflush
+    .p2align 2
+zpcodec_eflush:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+
+    mov     x19, x0
+
+    // Adjust subend
+    ldr     w9, [x19, 8]
+    mov     w10, #0x8000
+    cmp     w9, w10
+    b.hi    .Leflush_set_10000
+    cbz     w9, .Leflush_adjusted
+    str     w10, [x19, 8]           // subend = 0x8000
+    b       .Leflush_adjusted
+.Leflush_set_10000:
+    mov     w10, #1
+    lsl     w10, w10, #16
+    str     w10, [x19, 8]           // subend = 0x10000
+.Leflush_adjusted:
+
+    // while (buffer != 0xffffff || subend) zemit(1 - (subend>>15)), subend <<= 1
+.Leflush_emit_loop:
+    ldr     w9, [x19, 12]
+    mov     w10, #0xffff
+    movk    w10, #0x00ff, lsl #16
+    cmp     w9, w10
+    b.ne    .Leflush_do_emit
+    ldr     w11, [x19, 8]
+    cbz     w11, .Leflush_emit_done
+.Leflush_do_emit:
+    ldr     w11, [x19, 8]
+    lsr     w11, w11, #15
+    cmp     w11, #0
+    cset    w1, eq
+    mov     x0, x19
+    bl      zpcodec_zemit
+    ldr     w9, [x19, 8]
+    lsl     w9, w9, #1
+    and     w9, w9, #0xffff
+    str     w9, [x19, 8]
+    b       .Leflush_emit_loop
+.Leflush_emit_done:
+
+    // outbit(1), then nrun zeros
+    mov     x0, x19
+    mov     w1, #1
+    bl      zpcodec_outbit
+    ldr     w20, [x19, 16]
+    cbz     w20, .Leflush_run_done
+.Leflush_run_loop:
+    mov     x0, x19
+    mov     w1, wzr
+    bl      zpcodec_outbit
+    subs    w20, w20, #1
+    b.ne    .Leflush_run_loop
+.Leflush_run_done:
+    str     wzr, [x19, 16]          // nrun = 0
+
+    // Pad with ones until the byte boundary
+.Leflush_fill_loop:
+    ldrb    w9, [x19, 1]
+    cbz     w9, .Leflush_fill_done
+    mov     x0, x19
+    mov     w1, #1
+    bl      zpcodec_outbit
+    b       .Leflush_fill_loop
+.Leflush_fill_done:
+
+    mov     w9, #0xff
+    strb    w9, [x19, 2]            // delay = 0xff: no further emission
+
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+    .globl _zpcodec_eflush
+_zpcodec_eflush:
+    b       zpcodec_eflush
@@ -549,6 +549,30 @@ impl DjvuDocument {
         self.add_encoded_page(encoded)
     }
 
+    /// Encode a batch of pages on the rayon pool with work stealing.
+    ///
+    /// Each page is submitted as its own stealable task (`with_max_len(1)`
+    /// stops rayon from gluing consecutive pages into one unit, which would
+    /// recreate the static-partitioning imbalance on mixed-size batches).
+    /// Large pages fan out further on the same pool: their IW44 transform
+    /// runs per-scale band tasks internally, so idle workers steal slices of
+    /// a big page's transform while others code smaller pages. Results are
+    /// inserted into the collection as soon as each page finishes, keeping
+    /// the number of in-flight raw planes bounded by the worker count.
+    ///
+    /// Callers who need a specific thread count or memory cap can run this
+    /// inside `rayon::ThreadPool::install`. The first encode error aborts
+    /// the remaining work and is returned.
+    #[cfg(feature = "rayon")]
+    pub fn add_pages_parallel(&self, pages: Vec<Page>) -> Result<()> {
+        use rayon::prelude::*;
+
+        pages.into_par_iter().with_max_len(1).try_for_each(|page| {
+            let encoded = self.encode_page(page)?;
+            self.add_encoded_page(encoded)
+        })
+    }
+
     /// Finalize and return DjVu file bytes
     pub fn finalize(&self) -> Result<Vec<u8>> {
         if !self.is_complete() {
@@ -568,3 +592,39 @@ impl DjvuDocument {
         DocumentEncoder::assemble_pages(&pages)
     }
 }
+
+#[cfg(all(test, feature = "rayon"))]
+mod tests {
+    use super::*;
+    use crate::image::image_formats::{Pixel, Pixmap};
+
+    /// Work-stealing submission must produce the same document as serial
+    /// insertion, regardless of completion order.
+    #[test]
+    fn parallel_batch_matches_serial_document() {
+        // Page sizes vary so tasks finish out of order.
+        let sizes = [(40u32, 60u32), (120, 90), (30, 30), (90, 200), (64, 64)];
+        let make_pages = || -> Vec<Page> {
+            sizes
+                .iter()
+                .enumerate()
+                .map(|(i, &(w, h))| {
+                    let shade = (40 * i) as u8;
+                    let bg = Pixmap::from_pixel(w, h, Pixel::new(shade, shade, shade));
+                    PageBuilder::new(i, w, h).with_background(bg).unwrap().build().unwrap()
+                })
+                .collect()
+        };
+
+        let serial = DjvuBuilder::new(sizes.len()).build();
+        for page in make_pages() {
+            serial.add_page(page).unwrap();
+        }
+        let expected = serial.finalize().unwrap();
+
+        let parallel = DjvuBuilder::new(sizes.len()).build();
+        parallel.add_pages_parallel(make_pages()).unwrap();
+        assert!(parallel.is_complete());
+        assert_eq!(parallel.finalize().unwrap(), expected);
+    }
+}
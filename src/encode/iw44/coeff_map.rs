@@ -1,5 +1,7 @@
 use super::masking;
 use super::transform::Encode;
+#[cfg(not(feature = "rayon"))]
+use super::transform::StripTransform;
 use super::zigzag::ZIGZAG_LOC;
 use crate::image::image_formats::Bitmap;
 
@@ -106,6 +108,14 @@ impl Block {
     }
 }
 
+/// Padded planes at least this large take the two-stage transform/packing
+/// pipeline in `create_from_transform`; smaller ones are not worth a thread.
+/// Only used without rayon: the strip transform re-filters its overlap
+/// margins (~2.5x transform work at 256-row strips), which loses to the
+/// tiled `forward_parallel` path whenever that is available.
+#[cfg(not(feature = "rayon"))]
+const PIPELINE_MIN_PIXELS: usize = 1 << 21;
+
 /// Replaces `IW44Image::Map`. Owns all the coefficient blocks for one image component (Y, Cb, or Cr).
 #[derive(Debug, Clone)]
 pub struct CoeffMap {
@@ -179,6 +189,17 @@ impl CoeffMap {
         transform_fn(&mut data16, map.iw, map.ih, map.bw);
 
         let levels = ((map.iw.min(map.ih) as f32).log2() as usize).min(5);
+
+        // Without rayon, large unmasked planes overlap the memory-bound
+        // transform with block packing on a second thread; results are
+        // bit-identical. With rayon, forward() dispatches to the faster
+        // tiled parallel transform instead.
+        #[cfg(not(feature = "rayon"))]
+        if mask.is_none() && map.bw * map.bh >= PIPELINE_MIN_PIXELS {
+            map.populate_pipelined(&data16, levels);
+            return map;
+        }
+
         Encode::forward(&mut data16, map.iw, map.ih, map.bw, levels);
 
         if let Some(mask_img) = mask {
@@ -200,6 +221,76 @@ impl CoeffMap {
         map
     }
 
+    /// Two-stage transform/packing pipeline over `raw`, the untransformed
+    /// padded plane. A producer thread pushes rows through [`StripTransform`]
+    /// and hands completed 32-row coefficient bands over a two-deep channel
+    /// while this thread packs the previous band into blocks; band buffers
+    /// cycle back through a return channel, so the stages run double-buffered
+    /// and the bandwidth-bound transform overlaps the compute-bound packing.
+    #[cfg(not(feature = "rayon"))]
+    fn populate_pipelined(&mut self, raw: &[i16], levels: usize) {
+        use std::sync::mpsc;
+
+        /// One band is one row of 32x32 blocks.
+        const BAND_ROWS: usize = 32;
+
+        let (iw, ih, bw, bh) = (self.iw, self.ih, self.bw, self.bh);
+        let blocks_w = bw / 32;
+        let (full_tx, full_rx) = mpsc::sync_channel::<(usize, Vec<i16>)>(2);
+        let (free_tx, free_rx) = mpsc::channel::<Vec<i16>>();
+        for _ in 0..2 {
+            free_tx.send(vec![0i16; bw * BAND_ROWS]).expect("seed band buffers");
+        }
+
+        std::thread::scope(|s| {
+            s.spawn(move || {
+                let mut st = StripTransform::with_stride(iw, bw, ih, levels, 256);
+                // `band` collects transformed rows until a block row is full.
+                let mut band: Option<Vec<i16>> = Some(free_rx.recv().expect("band buffer"));
+                let mut base = 0usize;
+                let mut sink = |y: usize, row: &[i16]| {
+                    let buf = band.as_mut().expect("band in flight");
+                    let off = (y - base) * bw;
+                    buf[off..off + bw].copy_from_slice(row);
+                    if y + 1 - base == BAND_ROWS {
+                        full_tx.send((base, band.take().unwrap())).expect("packer alive");
+                        base += BAND_ROWS;
+                        if base < ih {
+                            let mut next = free_rx.recv().expect("band buffer");
+                            // Recycled buffers hold stale rows; rows past `ih`
+                            // in the final band must read as zero.
+                            next.fill(0);
+                            band = Some(next);
+                        }
+                    }
+                };
+                for y in 0..ih {
+                    st.push_row(&raw[y * bw..y * bw + bw], &mut sink);
+                }
+                st.finish(&mut sink);
+                drop(sink);
+                // Partial final band (heights not a multiple of 32).
+                if let Some(last) = band {
+                    if base < ih {
+                        full_tx.send((base, last)).expect("packer alive");
+                    }
+                }
+            });
+
+            for _ in 0..bh / BAND_ROWS {
+                let (base, band) = full_rx.recv().expect("transform thread alive");
+                let block_y = base / BAND_ROWS;
+                for block_x in 0..blocks_w {
+                    let mut liftblock = [0i16; 1024];
+                    Self::copy_block_data(&mut liftblock, &band, bw, block_x, 0);
+                    self.blocks[block_y * blocks_w + block_x].read_liftblock(&liftblock);
+                }
+                // Hand the buffer back; the producer may already be done.
+                let _ = free_tx.send(band);
+            }
+        });
+    }
+
     /// Create coefficients from an image. Corresponds to `Map::Encode::create`.
     pub fn create_from_image(img: &Bitmap, mask: Option<&Bitmap>) -> Self {
         let (w, h) = img.dimensions();
@@ -270,3 +361,58 @@ impl CoeffMap {
 mod zigzag_tests {
     // include!("zigzag_test.rs"); // Commented out since the file doesn't exist
 }
+
+#[cfg(all(test, not(feature = "rayon")))]
+mod pipeline_tests {
+    use super::*;
+
+    /// Serial reference: transform the plane in place, then pack blocks the
+    /// way `create_from_transform` does on its non-pipelined path.
+    fn populate_serial(map: &mut CoeffMap, raw: &[i16], levels: usize) {
+        let mut data16 = raw.to_vec();
+        Encode::forward(&mut data16, map.iw, map.ih, map.bw, levels);
+        let blocks_w = map.bw / 32;
+        for block_y in 0..(map.bh / 32) {
+            for block_x in 0..blocks_w {
+                let mut liftblock = [0i16; 1024];
+                CoeffMap::copy_block_data(&mut liftblock, &data16, map.bw, block_x, block_y);
+                map.blocks[block_y * blocks_w + block_x].read_liftblock(&liftblock);
+            }
+        }
+    }
+
+    #[test]
+    fn pipelined_blocks_match_serial_path() {
+        // Unaligned dimensions so the final band is partial and padding
+        // columns are exercised.
+        for &(w, h) in &[(100usize, 75usize), (64, 64), (33, 130)] {
+            let mut map_a = CoeffMap::new(w, h);
+            let mut map_b = map_a.clone();
+            let levels = ((w.min(h) as f32).log2() as usize).min(5);
+
+            // Signal only inside the image area; padding stays zero as in
+            // create_from_transform.
+            let mut raw = vec![0i16; map_a.bw * map_a.bh];
+            let mut state = 0x2b5e_u64 | (w as u64) << 32;
+            for y in 0..h {
+                for x in 0..w {
+                    state ^= state << 13;
+                    state ^= state >> 7;
+                    state ^= state << 17;
+                    raw[y * map_a.bw + x] = (state as i16) >> 6;
+                }
+            }
+
+            populate_serial(&mut map_a, &raw, levels);
+            map_b.populate_pipelined(&raw, levels);
+
+            for (i, (a, b)) in map_a.blocks.iter().zip(&map_b.blocks).enumerate() {
+                let mut lift_a = [0i16; 1024];
+                let mut lift_b = [0i16; 1024];
+                a.write_liftblock(&mut lift_a);
+                b.write_liftblock(&mut lift_b);
+                assert_eq!(lift_a, lift_b, "block {} differs at {}x{}", i, w, h);
+            }
+        }
+    }
+}
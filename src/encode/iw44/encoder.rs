@@ -449,7 +449,7 @@ impl IWEncoder {
         #[cfg(feature = "asm_zp")]
         let mut zp_impl = crate::encode::zc::asm::ZEncoder::new(Cursor::new(Vec::new()), true)?;
         #[cfg(not(feature = "asm_zp"))]
-        let mut zp_impl = crate::encode::zc::zcodec::ZEncoder::new(Cursor::new(Vec::new()), true)?;
+        let mut zp_impl = crate::encode::zc::zcodec::ZEncoder::new_const::<true>(Cursor::new(Vec::new()))?;
         let mut slices_encoded = 0;
         let mut estdb = -1.0;
 
@@ -12,7 +12,10 @@ pub mod encoder;
 pub mod masking;
 #[cfg(test)]
 mod tests;
+pub mod trace;
 pub mod transform;
+#[cfg(target_arch = "x86_64")]
+mod transform_simd;
 pub mod zigzag;
 
 // Re-export commonly used types and functions
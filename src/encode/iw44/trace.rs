@@ -0,0 +1,76 @@
+// src/encode/iw44/trace.rs
+
+//! Compile-time-selectable tracing for the IW44 transform hot paths.
+//!
+//! The C++ reference code emitted `TRANSFORM_TRACE` lines with `fprintf` from
+//! inside the filter loops, which serializes every encode on stderr locking.
+//! Here tracing is a policy selected at compile time:
+//!
+//! * default: the `iw_trace!` macro expands to nothing — zero instructions on
+//!   the hot path;
+//! * `--features iw44-trace`: trace records go to stderr;
+//! * `--features iw44-trace-ring`: trace records go to an in-process ring
+//!   buffer that can be drained after the fact with [`drain_ring`], keeping
+//!   the hot path free of I/O during bitstream-divergence hunts.
+
+/// Emits a trace record for the IW44 transform.
+///
+/// Compiles to nothing unless the `iw44-trace` feature is enabled.
+macro_rules! iw_trace {
+    ($($arg:tt)*) => {{
+        #[cfg(feature = "iw44-trace")]
+        $crate::encode::iw44::trace::record(format_args!($($arg)*));
+    }};
+}
+pub(crate) use iw_trace;
+
+#[cfg(feature = "iw44-trace")]
+pub fn record(args: std::fmt::Arguments) {
+    #[cfg(feature = "iw44-trace-ring")]
+    {
+        ring::record(args);
+    }
+    #[cfg(not(feature = "iw44-trace-ring"))]
+    {
+        eprintln!("TRANSFORM_TRACE {}", args);
+    }
+}
+
+/// Drains and returns all buffered trace records (ring-buffer sink only).
+#[cfg(feature = "iw44-trace-ring")]
+pub fn drain_ring() -> Vec<String> {
+    ring::drain()
+}
+
+#[cfg(feature = "iw44-trace-ring")]
+mod ring {
+    use std::collections::VecDeque;
+    use std::sync::Mutex;
+
+    /// Bounded capacity: the oldest records are dropped once full, so a long
+    /// encode cannot grow memory without bound.
+    const CAPACITY: usize = 4096;
+
+    static RING: Mutex<VecDeque<String>> = Mutex::new(VecDeque::new());
+
+    pub(super) fn record(args: std::fmt::Arguments) {
+        let mut ring = RING.lock().unwrap();
+        if ring.len() == CAPACITY {
+            ring.pop_front();
+        }
+        ring.push_back(args.to_string());
+    }
+
+    pub(super) fn drain() -> Vec<String> {
+        RING.lock().unwrap().drain(..).collect()
+    }
+}
+
+/// Cheap wrapping checksum of a coefficient region, used by the trace points
+/// so a divergence can be localized to a (scale, pass) without logging every
+/// coefficient.
+#[cfg(feature = "iw44-trace")]
+pub fn plane_checksum(buf: &[i16]) -> u32 {
+    buf.iter()
+        .fold(0u32, |acc, &c| acc.rotate_left(5).wrapping_add(c as u16 as u32))
+}
@@ -1,10 +1,29 @@
-// Removed SIMD dependencies for stable Rust compatibility
-
 use crate::image::image_formats::Bitmap;
 
+use super::trace::iw_trace;
+#[cfg(target_arch = "x86_64")]
+use super::transform_simd;
+
+/// SIMD instruction set selected for the lifting filters (`None` = scalar).
+#[cfg(target_arch = "x86_64")]
+type SimdSel = Option<transform_simd::Isa>;
+#[cfg(not(target_arch = "x86_64"))]
+type SimdSel = Option<()>;
+
+/// Picks a SIMD path for the lifting filters when the geometry allows it.
+/// Only `scale == 1` is vectorized; it accounts for ~75% of the transform work.
+fn simd_select(scale: usize, w: usize) -> SimdSel {
+    #[cfg(target_arch = "x86_64")]
+    if scale == 1 && w >= 16 {
+        return transform_simd::detect();
+    }
+    let _ = (scale, w);
+    None
+}
+
 /// Saturating conversion from i32 to i16 to prevent overflow
 #[inline]
-fn _sat16(x: i32) -> i16 {
+fn sat16(x: i32) -> i16 {
     if x > 32_767 {
         32_767
     } else if x < -32_768 {
@@ -14,6 +33,34 @@ fn _sat16(x: i32) -> i16 {
     }
 }
 
+/// How a 32-bit lifting result is narrowed back into the i16 plane. The
+/// arithmetic inside every step is already 32-bit; only this final store can
+/// lose range.
+trait StorePolicy {
+    fn store(x: i32) -> i16;
+}
+
+/// Truncating store matching djvulibre (and the SIMD kernels): coefficients
+/// outside the i16 range wrap. Fine for 8-bit imagery, whose coefficients
+/// never leave the range.
+struct WrappingStore;
+impl StorePolicy for WrappingStore {
+    #[inline(always)]
+    fn store(x: i32) -> i16 {
+        x as i16
+    }
+}
+
+/// Clamping store for high-dynamic-range input, where a wrapped coefficient
+/// flips sign and inflates every band coded after it.
+struct SaturatingStore;
+impl StorePolicy for SaturatingStore {
+    #[inline(always)]
+    fn store(x: i32) -> i16 {
+        sat16(x)
+    }
+}
+
 /// Create gray level conversion table (bconv) matching C++ IW44EncodeCodec.cpp:1656
 /// This handles different bit depths and ensures proper value clamping.
 fn create_bconv_table(grays: u32) -> [i8; 256] {
@@ -33,6 +80,41 @@ fn create_bconv_table(grays: u32) -> [i8; 256] {
     bconv
 }
 
+/// Counters for one scale of the forward transform: wall-clock time per
+/// lifting pass plus the bytes each pass sweeps. Always compiled — the cost
+/// is two `Instant` reads per pass, so there is no debug-define variant.
+#[derive(Debug, Clone, Copy)]
+pub struct ScaleStats {
+    /// Subsampling step this scale ran at (1, 2, 4, ...).
+    pub scale: usize,
+    /// Wall-clock duration of the horizontal lifting pass.
+    pub fh: std::time::Duration,
+    /// Wall-clock duration of the vertical lifting pass.
+    pub fv: std::time::Duration,
+    /// Bytes read/written by both passes at this scale.
+    pub bytes_touched: usize,
+}
+
+/// Per-scale performance counters accumulated by [`Encode::forward_with_stats`].
+/// One entry is pushed per decomposition level, so repeated transforms into
+/// the same struct aggregate naturally for export to a metrics pipeline.
+#[derive(Debug, Clone, Default)]
+pub struct TransformStats {
+    pub scales: Vec<ScaleStats>,
+}
+
+impl TransformStats {
+    /// Total wall-clock time across all recorded passes.
+    pub fn total(&self) -> std::time::Duration {
+        self.scales.iter().map(|s| s.fh + s.fv).sum()
+    }
+
+    /// Total bytes swept across all recorded passes.
+    pub fn bytes_touched(&self) -> usize {
+        self.scales.iter().map(|s| s.bytes_touched).sum()
+    }
+}
+
 pub struct Encode;
 
 impl Encode {
@@ -155,10 +237,147 @@ impl Encode {
     /// Forward wavelet transform using the streaming algorithm from DjVuLibre.
     /// Now operates on i16 throughout, matching C++'s short* buffer behavior.
     pub fn forward(buf: &mut [i16], w: usize, h: usize, rowsize: usize, levels: usize) {
+        iw_trace!("forward w={} h={} rowsize={} levels={}", w, h, rowsize, levels);
+        // Large planes go through the tiled parallel mode when rayon is
+        // available; small ones are not worth the task overhead.
+        #[cfg(feature = "rayon")]
+        if w * h >= PARALLEL_MIN_PIXELS {
+            return Self::forward_parallel(buf, w, h, rowsize, levels);
+        }
         let mut scale = 1;
         for _ in 0..levels {
             filter_fh(buf, w, h, rowsize, scale);
+            iw_trace!(
+                "fh scale={} cksum={:#010x}",
+                scale,
+                super::trace::plane_checksum(buf)
+            );
             filter_fv(buf, w, h, rowsize, scale);
+            iw_trace!(
+                "fv scale={} cksum={:#010x}",
+                scale,
+                super::trace::plane_checksum(buf)
+            );
+            scale <<= 1;
+        }
+    }
+
+    /// Forward wavelet transform with per-scale counters (exact same results
+    /// as [`forward`]).
+    ///
+    /// Appends one [`ScaleStats`] per level to the caller-supplied `stats`,
+    /// giving pass durations and memory traffic without a rebuild. Runs the
+    /// single-threaded passes so each measurement covers exactly one pass.
+    ///
+    /// [`forward`]: Self::forward
+    pub fn forward_with_stats(
+        buf: &mut [i16],
+        w: usize,
+        h: usize,
+        rowsize: usize,
+        levels: usize,
+        stats: &mut TransformStats,
+    ) {
+        let mut scale = 1;
+        for _ in 0..levels {
+            let t0 = std::time::Instant::now();
+            filter_fh(buf, w, h, rowsize, scale);
+            let t1 = std::time::Instant::now();
+            filter_fv(buf, w, h, rowsize, scale);
+            let t2 = std::time::Instant::now();
+            // fh sweeps one row of w coefficients per scaled row; fv sweeps
+            // one column of h coefficients per scaled column.
+            let fh_bytes = 2 * w * h.div_ceil(scale);
+            let fv_bytes = 2 * h * w.div_ceil(scale);
+            stats.scales.push(ScaleStats {
+                scale,
+                fh: t1 - t0,
+                fv: t2 - t1,
+                bytes_touched: fh_bytes + fv_bytes,
+            });
+            scale <<= 1;
+        }
+    }
+
+    /// Tiled parallel forward transform (exact same results as [`forward`]).
+    ///
+    /// Both lifting passes decompose without halo exchange: the horizontal
+    /// filter never reads outside its own row, and the vertical filter never
+    /// reads outside its own column, so the plane is split into row bands for
+    /// `filter_fh` and column bands for `filter_fv` with no overlap at all.
+    /// Work runs on the current rayon pool; callers with their own pool
+    /// inject a thread count via `rayon::ThreadPool::install`.
+    ///
+    /// [`forward`]: Self::forward
+    #[cfg(feature = "rayon")]
+    pub fn forward_parallel(buf: &mut [i16], w: usize, h: usize, rowsize: usize, levels: usize) {
+        iw_trace!("forward_parallel w={} h={} rowsize={} levels={}", w, h, rowsize, levels);
+        let mut scale = 1;
+        for _ in 0..levels {
+            filter_fh_parallel(buf, w, h, rowsize, scale);
+            iw_trace!(
+                "fh scale={} cksum={:#010x}",
+                scale,
+                super::trace::plane_checksum(buf)
+            );
+            filter_fv_parallel(buf, w, h, rowsize, scale);
+            iw_trace!(
+                "fv scale={} cksum={:#010x}",
+                scale,
+                super::trace::plane_checksum(buf)
+            );
+            scale <<= 1;
+        }
+    }
+
+    /// Cache-blocked forward transform fusing both lifting passes per scale
+    /// (exact same results as [`forward`]).
+    ///
+    /// Each scale sweeps memory once instead of twice: see [`filter_fused`]
+    /// for how the horizontal frontier tracks the vertical pass. Worthwhile
+    /// for planes larger than the last-level cache, where the split passes
+    /// pay two DRAM round-trips per scale.
+    ///
+    /// [`forward`]: Self::forward
+    pub fn forward_fused(buf: &mut [i16], w: usize, h: usize, rowsize: usize, levels: usize) {
+        iw_trace!("forward_fused w={} h={} rowsize={} levels={}", w, h, rowsize, levels);
+        let mut scale = 1;
+        for _ in 0..levels {
+            filter_fused(buf, w, h, rowsize, scale);
+            iw_trace!(
+                "fused scale={} cksum={:#010x}",
+                scale,
+                super::trace::plane_checksum(buf)
+            );
+            scale <<= 1;
+        }
+    }
+
+    /// Overflow-safe variant of [`forward`](Self::forward) for
+    /// high-dynamic-range input: every coefficient store clamps to the i16
+    /// range instead of truncating, so pathological planes cannot wrap a
+    /// coefficient's sign. Inputs whose coefficients stay in range produce
+    /// output identical to [`forward`](Self::forward), so callers can drop
+    /// any pre-pass range-clamping scan and select this mode unconditionally
+    /// for untrusted data. Runs the scalar kernels only — the SIMD paths use
+    /// truncating stores.
+    pub fn forward_saturating(buf: &mut [i16], w: usize, h: usize, rowsize: usize, levels: usize) {
+        iw_trace!("forward_saturating w={} h={} rowsize={} levels={}", w, h, rowsize, levels);
+        let mut scale = 1;
+        for _ in 0..levels {
+            filter_fh_scalar_p::<SaturatingStore>(buf, w, h, rowsize, scale);
+            // Safety: the exclusive borrow spans the whole plane.
+            unsafe {
+                filter_fv_steps::<SaturatingStore>(
+                    buf.as_mut_ptr(),
+                    w,
+                    h,
+                    rowsize,
+                    scale,
+                    None,
+                    |_| {},
+                );
+            }
             scale <<= 1;
         }
     }
@@ -184,8 +403,129 @@ impl Encode {
     }
 }
 
+/// Planes below this size run the transform sequentially even with rayon.
+#[cfg(feature = "rayon")]
+const PARALLEL_MIN_PIXELS: usize = 1 << 20;
+
+/// Raw plane pointer that can be captured by rayon tasks. Each task accesses
+/// only the elements of its own column band, so no element is shared.
+#[cfg(feature = "rayon")]
+#[derive(Clone, Copy)]
+struct PlanePtr(*mut i16);
+#[cfg(feature = "rayon")]
+impl PlanePtr {
+    // Method call (not field access) so closures capture the Send wrapper
+    // as a whole rather than the raw pointer field.
+    fn get(self) -> *mut i16 {
+        self.0
+    }
+}
+#[cfg(feature = "rayon")]
+unsafe impl Send for PlanePtr {}
+#[cfg(feature = "rayon")]
+unsafe impl Sync for PlanePtr {}
+
+/// Horizontal filter over row bands in parallel. At scale `s` the filter
+/// touches rows 0, s, 2s, ... independently, so chunks of `s` rows each hold
+/// exactly one row of work.
+#[cfg(feature = "rayon")]
+fn filter_fh_parallel(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize) {
+    use rayon::prelude::*;
+
+    let nrows = h.div_ceil(scale);
+    if nrows < 2 {
+        filter_fh(buf, w, h, rowsize, scale);
+        return;
+    }
+    let chunk = rowsize * scale;
+    let used = buf.len().min(chunk * nrows);
+    buf[..used].par_chunks_mut(chunk).for_each_init(
+        || vec![0i32; w / 2 + 4],
+        |scratch, rows| {
+            #[cfg(target_arch = "x86_64")]
+            if let Some(isa) = simd_select(scale, w) {
+                transform_simd::fh_row(isa, rows, 0, w, scratch);
+                return;
+            }
+            let _ = &scratch;
+            filter_fh_scalar(rows, w, 1, rowsize, scale);
+        },
+    );
+}
+
+/// Vertical filter over column bands in parallel. Every access in the
+/// vertical lifting pass stays in its own column (`q ± k*scale*rowsize`), so
+/// running `filter_fv_with` on a shifted view with a narrower width covers
+/// columns `[x0, x0+bw)` exactly as the full-plane call would.
+#[cfg(feature = "rayon")]
+fn filter_fv_parallel(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize) {
+    let threads = rayon::current_num_threads();
+    // Band boundaries must sit on multiples of `scale` to keep the column
+    // set `0, scale, 2*scale, ...` intact across bands.
+    let mut band = w.div_ceil(threads.max(1));
+    band = band.div_ceil(scale) * scale;
+    band = band.max(64 * scale);
+    if band >= w {
+        filter_fv(buf, w, h, rowsize, scale);
+        return;
+    }
+    let ptr = PlanePtr(buf.as_mut_ptr());
+    rayon::scope(|s| {
+        let mut x0 = 0usize;
+        while x0 < w {
+            let bw = band.min(w - x0);
+            s.spawn(move |_| {
+                // Safety: bands cover disjoint column ranges, the vertical
+                // sweep never strays outside its own column, and the raw
+                // core touches elements without materializing a view, so no
+                // two tasks alias.
+                unsafe {
+                    filter_fv_steps::<WrappingStore>(
+                        ptr.get().add(x0),
+                        bw,
+                        h,
+                        rowsize,
+                        scale,
+                        simd_select(scale, bw),
+                        |_| {},
+                    );
+                }
+            });
+            x0 += band;
+        }
+    });
+}
+
+/// Horizontal filter: SIMD two-phase path at scale 1, streaming scalar otherwise.
+fn filter_fh(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize) {
+    #[cfg(target_arch = "x86_64")]
+    if let Some(isa) = simd_select(scale, w) {
+        // Untruncated odd-position predictions, shared across rows; the
+        // zeroed padding slots model out-of-row neighbors.
+        let mut scratch = vec![0i32; w / 2 + 4];
+        let mut p = 0usize;
+        for _y in 0..h {
+            transform_simd::fh_row(isa, buf, p, w, &mut scratch);
+            p += rowsize;
+        }
+        return;
+    }
+    filter_fh_scalar(buf, w, h, rowsize, scale)
+}
+
 /// Streaming horizontal filter - operates on i16 like C++ (port of filter_fh from IW44EncodeCodec.cpp:514)
-fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usize) {
+fn filter_fh_scalar(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize) {
+    filter_fh_scalar_p::<WrappingStore>(buf, w, h, rowsize, scale)
+}
+
+/// Horizontal filter core, generic over the coefficient [`StorePolicy`].
+fn filter_fh_scalar_p<S: StorePolicy>(
+    buf: &mut [i16],
+    w: usize,
+    h: usize,
+    mut rowsize: usize,
+    scale: usize,
+) {
     let s = scale;
     let s3 = s + s + s;
     rowsize *= scale;
@@ -216,7 +556,7 @@ fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usi
                 a3 = buf[q + s3] as i32;
             }
             b3 = (buf[q] as i32) - ((a1 + a2 + 1) >> 1);
-            buf[q] = b3 as i16; // Store back to i16 (plain cast, no saturation)
+            buf[q] = S::store(b3);
             q += s + s;
         }
 
@@ -231,7 +571,7 @@ fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usi
             // FIX: Prediction uses +8 >> 4 (matches C: ((a1+a2)<<3)+(a1+a2)-a0-a3+8)>>4)
             let _old_val = buf[q];
             b3 = (buf[q] as i32) - ((((a1 + a2) << 3) + (a1 + a2) - a0 - a3 + 8) >> 4);
-            buf[q] = b3 as i16;
+            buf[q] = S::store(b3);
 
             let idx_i = q as isize - s3 as isize;
             if idx_i >= 0 {
@@ -239,7 +579,7 @@ fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usi
                 // FIX: Update uses +16 >> 5 (matches C: ((b1+b2)<<3)+(b1+b2)-b0-b3+16)>>5)
                 let updated =
                     (buf[idx] as i32) + ((((b1 + b2) << 3) + (b1 + b2) - b0 - b3 + 16) >> 5);
-                buf[idx] = updated as i16; // Store back to i16
+                buf[idx] = S::store(updated);
             }
             q += s + s;
         }
@@ -252,14 +592,14 @@ fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usi
             b1 = b2;
             b2 = b3;
             b3 = (buf[q] as i32) - ((a1 + a2 + 1) >> 1);
-            buf[q] = b3 as i16;
+            buf[q] = S::store(b3);
             let idx_i = q as isize - s3 as isize;
             if idx_i >= p as isize {
                 let idx = idx_i as usize;
                 // Complex update filter with +16 >> 5 (matches C)
                 let updated =
                     (buf[idx] as i32) + ((((b1 + b2) << 3) + (b1 + b2) - b0 - b3 + 16) >> 5);
-                buf[idx] = updated as i16;
+                buf[idx] = S::store(updated);
             }
             q += s + s;
         }
@@ -276,7 +616,7 @@ fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usi
                 // Complex update filter with +16 >> 5 (matches C)
                 let updated =
                     (buf[idx] as i32) + ((((b1 + b2) << 3) + (b1 + b2) - b0 - b3 + 16) >> 5);
-                buf[idx] = updated as i16;
+                buf[idx] = S::store(updated);
             }
             q += s + s;
         }
@@ -286,120 +626,610 @@ fn filter_fh(buf: &mut [i16], w: usize, h: usize, mut rowsize: usize, scale: usi
     }
 }
 
-/// Streaming vertical filter (port of filter_fv from IW44EncodeCodec.cpp:404)
+/// Vertical filter: dispatches the generic rows to SIMD kernels when possible.
 fn filter_fv(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize) {
-    let s = scale * rowsize;
-    let s3 = s + s + s;
-    let mut y = 1usize;
-    let mut p = s;
-    let h_adj = if h > 0 { ((h - 1) / scale) + 1 } else { 0 };
-    let hlimit = h_adj;
-
-    while y as isize - 3 < hlimit as isize {
-        // 1-Delta (prediction)
-        {
-            let mut q = p;
-            let e = q + w;
-            if y >= 3 && y + 3 < hlimit {
-                // Generic case: prediction uses +8>>4 (matches C)
-                while q < e {
-                    let a = if q >= s { buf[q - s] as i32 } else { 0 } + buf[q + s] as i32;
-                    let b = if q >= s3 { buf[q - s3] as i32 } else { 0 } + buf[q + s3] as i32;
-                    buf[q] = (buf[q] as i32 - (((a << 3) + a - b + 8) >> 4)) as i16;
-                    q += scale;
-                }
-            } else if y < hlimit {
-                // Special case: simple average
-                let mut q1 = if y + 1 < hlimit { q + s } else { q - s };
-                while q < e {
-                    let val_qs = buf[q - s] as i32;
-                    let val_q1 = buf[q1] as i32;
-                    let a = val_qs + val_q1;
-                    buf[q] = (buf[q] as i32 - ((a + 1) >> 1)) as i16;
-                    q += scale;
-                    q1 += scale;
-                }
-            }
-        }
+    filter_fv_with(buf, w, h, rowsize, scale, simd_select(scale, w))
+}
 
-        // 2-Update
-        {
-            let q_i = p as isize - s3 as isize;
-            if q_i >= 0 {
-                let mut q = q_i as usize;
+/// Streaming vertical filter (port of filter_fv from IW44EncodeCodec.cpp:404)
+fn filter_fv_with(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize, simd: SimdSel) {
+    // Safety: the exclusive borrow spans the whole plane the sweep touches.
+    unsafe { filter_fv_steps::<WrappingStore>(buf.as_mut_ptr(), w, h, rowsize, scale, simd, |_| {}) }
+}
+
+/// Vertical filter core with a per-step hook, working through a raw plane
+/// pointer.
+///
+/// Raw element access keeps the parallel column bands sound: all bands share
+/// one allocation, and per-band `&mut [i16]` views would be overlapping
+/// exclusive borrows even though the element sets are disjoint. Serial
+/// callers go through the safe slice wrappers.
+///
+/// `prepare(y)` runs before the lifting step at scaled row `y`; the fused
+/// pass uses it to horizontally filter rows just before the vertical pass
+/// first reads them, while `filter_fv_with` passes a no-op.
+///
+/// # Safety
+/// For every element index `i` this sweep touches (rows `0..ceil(h/scale)`,
+/// columns `0, scale, .., < w`, stride `rowsize`), `ptr.add(i)` must be valid
+/// for reads and writes and not accessed by anyone else for the duration of
+/// the call.
+unsafe fn filter_fv_steps<S: StorePolicy>(
+    ptr: *mut i16,
+    w: usize,
+    h: usize,
+    rowsize: usize,
+    scale: usize,
+    simd: SimdSel,
+    mut prepare: impl FnMut(usize),
+) {
+    unsafe {
+        let s = scale * rowsize;
+        let s3 = s + s + s;
+        let mut y = 1usize;
+        let mut p = s;
+        let h_adj = if h > 0 { ((h - 1) / scale) + 1 } else { 0 };
+        let hlimit = h_adj;
+
+        while y as isize - 3 < hlimit as isize {
+            prepare(y);
+
+            // 1-Delta (prediction)
+            {
+                let mut q = p;
                 let e = q + w;
-                if y >= 6 && y < hlimit {
-                    // Generic case: update uses +16>>5 (matches C)
+                if y >= 3 && y + 3 < hlimit {
+                    // Generic case: prediction uses +8>>4 (matches C)
+                    if let Some(isa) = simd {
+                        #[cfg(target_arch = "x86_64")]
+                        transform_simd::fv_predict_row(isa, ptr, q, w, rowsize);
+                        #[cfg(not(target_arch = "x86_64"))]
+                        let _ = isa; // unreachable: simd_select() is always None here
+                    } else {
+                        while q < e {
+                            let a = if q >= s { *ptr.add(q - s) as i32 } else { 0 } + *ptr.add(q + s) as i32;
+                            let b =
+                                if q >= s3 { *ptr.add(q - s3) as i32 } else { 0 } + *ptr.add(q + s3) as i32;
+                            *ptr.add(q) = S::store(*ptr.add(q) as i32 - (((a << 3) + a - b + 8) >> 4));
+                            q += scale;
+                        }
+                    }
+                } else if y < hlimit {
+                    // Special case: simple average
+                    let mut q1 = if y + 1 < hlimit { q + s } else { q - s };
                     while q < e {
-                        let a = if q >= s { buf[q - s] as i32 } else { 0 } + buf[q + s] as i32;
-                        let b = if q >= s3 { buf[q - s3] as i32 } else { 0 } + buf[q + s3] as i32;
-                        buf[q] = (buf[q] as i32 + (((a << 3) + a - b + 16) >> 5)) as i16;
+                        let val_qs = *ptr.add(q - s) as i32;
+                        let val_q1 = *ptr.add(q1) as i32;
+                        let a = val_qs + val_q1;
+                        *ptr.add(q) = S::store(*ptr.add(q) as i32 - ((a + 1) >> 1));
                         q += scale;
+                        q1 += scale;
                     }
-                } else if y >= 3 {
-                    // Special cases with boundary handling (matches C++: else if (y>=3))
-                    // q1 corresponds to q+s when (y-2 < hlimit)
-                    // q3 corresponds to q+s3 when (y < hlimit)
-                    let mut q1 = if y >= 2 && y - 2 < hlimit {
-                        Some(q + s)
-                    } else {
-                        None
-                    };
-                    let mut q3 = if y < hlimit { Some(q + s3) } else { None };
+                }
+            }
 
-                    if y >= 6 {
-                        // y>=6 but y>=hlimit (generic update couldn't run)
-                        while q < e {
-                            let a = if q >= s { buf[q - s] as i32 } else { 0 }
-                                + q1.map(|idx| buf[idx] as i32).unwrap_or(0);
-                            let b = if q >= s3 { buf[q - s3] as i32 } else { 0 }
-                                + q3.map(|idx| buf[idx] as i32).unwrap_or(0);
-                            buf[q] = (buf[q] as i32 + (((a << 3) + a - b + 16) >> 5)) as i16;
-                            q += scale;
-                            if let Some(ref mut idx) = q1 {
-                                *idx += scale;
-                            }
-                            if let Some(ref mut idx) = q3 {
-                                *idx += scale;
+            // 2-Update
+            {
+                let q_i = p as isize - s3 as isize;
+                if q_i >= 0 {
+                    let mut q = q_i as usize;
+                    let e = q + w;
+                    if y >= 6 && y < hlimit {
+                        // Generic case: update uses +16>>5 (matches C)
+                        if let Some(isa) = simd {
+                            #[cfg(target_arch = "x86_64")]
+                            transform_simd::fv_update_row(isa, ptr, q, w, rowsize);
+                            #[cfg(not(target_arch = "x86_64"))]
+                            let _ = isa; // unreachable: simd_select() is always None here
+                        } else {
+                            while q < e {
+                                let a =
+                                    if q >= s { *ptr.add(q - s) as i32 } else { 0 } + *ptr.add(q + s) as i32;
+                                let b =
+                                    if q >= s3 { *ptr.add(q - s3) as i32 } else { 0 } + *ptr.add(q + s3) as i32;
+                                *ptr.add(q) = S::store(*ptr.add(q) as i32 + (((a << 3) + a - b + 16) >> 5));
+                                q += scale;
                             }
                         }
-                    } else if y >= 4 {
-                        // y in [4, 5]
-                        while q < e {
-                            let a = if q >= s { buf[q - s] as i32 } else { 0 }
-                                + q1.map(|idx| buf[idx] as i32).unwrap_or(0);
-                            let b = q3.map(|idx| buf[idx] as i32).unwrap_or(0);
-                            buf[q] = (buf[q] as i32 + (((a << 3) + a - b + 16) >> 5)) as i16;
-                            q += scale;
-                            if let Some(ref mut idx) = q1 {
-                                *idx += scale;
+                    } else if y >= 3 {
+                        // Special cases with boundary handling (matches C++: else if (y>=3))
+                        // q1 corresponds to q+s when (y-2 < hlimit)
+                        // q3 corresponds to q+s3 when (y < hlimit)
+                        let mut q1 = if y >= 2 && y - 2 < hlimit {
+                            Some(q + s)
+                        } else {
+                            None
+                        };
+                        let mut q3 = if y < hlimit { Some(q + s3) } else { None };
+
+                        if y >= 6 {
+                            // y>=6 but y>=hlimit (generic update couldn't run)
+                            while q < e {
+                                let a = if q >= s { *ptr.add(q - s) as i32 } else { 0 }
+                                    + q1.map(|idx| *ptr.add(idx) as i32).unwrap_or(0);
+                                let b = if q >= s3 { *ptr.add(q - s3) as i32 } else { 0 }
+                                    + q3.map(|idx| *ptr.add(idx) as i32).unwrap_or(0);
+                                *ptr.add(q) = S::store(*ptr.add(q) as i32 + (((a << 3) + a - b + 16) >> 5));
+                                q += scale;
+                                if let Some(ref mut idx) = q1 {
+                                    *idx += scale;
+                                }
+                                if let Some(ref mut idx) = q3 {
+                                    *idx += scale;
+                                }
                             }
-                            if let Some(ref mut idx) = q3 {
-                                *idx += scale;
+                        } else if y >= 4 {
+                            // y in [4, 5]
+                            while q < e {
+                                let a = if q >= s { *ptr.add(q - s) as i32 } else { 0 }
+                                    + q1.map(|idx| *ptr.add(idx) as i32).unwrap_or(0);
+                                let b = q3.map(|idx| *ptr.add(idx) as i32).unwrap_or(0);
+                                *ptr.add(q) = S::store(*ptr.add(q) as i32 + (((a << 3) + a - b + 16) >> 5));
+                                q += scale;
+                                if let Some(ref mut idx) = q1 {
+                                    *idx += scale;
+                                }
+                                if let Some(ref mut idx) = q3 {
+                                    *idx += scale;
+                                }
                             }
-                        }
-                    } else {
-                        // y == 3
-                        while q < e {
-                            let a = q1.map(|idx| buf[idx] as i32).unwrap_or(0);
-                            let b = q3.map(|idx| buf[idx] as i32).unwrap_or(0);
-                            buf[q] = (buf[q] as i32 + (((a << 3) + a - b + 16) >> 5)) as i16;
-                            q += scale;
-                            if let Some(ref mut idx) = q1 {
-                                *idx += scale;
-                            }
-                            if let Some(ref mut idx) = q3 {
-                                *idx += scale;
+                        } else {
+                            // y == 3
+                            while q < e {
+                                let a = q1.map(|idx| *ptr.add(idx) as i32).unwrap_or(0);
+                                let b = q3.map(|idx| *ptr.add(idx) as i32).unwrap_or(0);
+                                *ptr.add(q) = S::store(*ptr.add(q) as i32 + (((a << 3) + a - b + 16) >> 5));
+                                q += scale;
+                                if let Some(ref mut idx) = q1 {
+                                    *idx += scale;
+                                }
+                                if let Some(ref mut idx) = q3 {
+                                    *idx += scale;
+                                }
                             }
                         }
                     }
                 }
             }
+
+            // y is in the scaled coordinate system because hlimit = ceil(h/scale)
+            // (matches C++: y += 2)
+            y += 2;
+            p += s + s;
+        }
+    }
+}
+
+/// Fused horizontal+vertical lifting pass for one scale.
+///
+/// Instead of streaming the plane once through `filter_fh` and again through
+/// `filter_fv`, the vertical pass pulls rows through a horizontal frontier
+/// right before it first needs them: the prediction step at scaled row `y`
+/// reads up to row `y + 3`, so the frontier stays that far ahead and each
+/// block of rows is touched once per scale while still hot in cache.
+/// Results are bit-identical to the two-pass order because the horizontal
+/// filter only touches its own row and every row crosses the frontier
+/// before the vertical pass reads or writes it.
+fn filter_fused(buf: &mut [i16], w: usize, h: usize, rowsize: usize, scale: usize) {
+    let hlimit = if h > 0 { ((h - 1) / scale) + 1 } else { 0 };
+    let simd = simd_select(scale, w);
+    let mut scratch = vec![0i32; w / 2 + 4];
+    let mut next = 0usize; // next scaled row awaiting the horizontal filter
+    let len = buf.len();
+    let ptr = buf.as_mut_ptr();
+    // Safety: single-threaded; the vertical core holds no borrow while the
+    // hook runs, so the hook's temporary row views are exclusive.
+    unsafe {
+        filter_fv_steps::<WrappingStore>(ptr, w, h, rowsize, scale, simd, |y| {
+            let upto = (y + 4).min(hlimit);
+            while next < upto {
+                let p = next * scale * rowsize;
+                let rows = std::slice::from_raw_parts_mut(ptr, len);
+                #[cfg(target_arch = "x86_64")]
+                if let Some(isa) = simd {
+                    transform_simd::fh_row(isa, rows, p, w, &mut scratch);
+                    next += 1;
+                    continue;
+                }
+                let _ = &mut scratch;
+                filter_fh_scalar(&mut rows[p..], w, 1, rowsize, scale);
+                next += 1;
+            }
+        });
+    }
+}
+
+/// A rectangle of edited pixels, in plane coordinates.
+#[derive(Debug, Clone, Copy)]
+pub struct DirtyRect {
+    pub x: usize,
+    pub y: usize,
+    pub w: usize,
+    pub h: usize,
+}
+
+impl Encode {
+    /// Incrementally updates a transformed plane after regional edits.
+    ///
+    /// `coeffs` holds the forward transform of the previous raw plane and
+    /// `raw` the edited raw plane; only coefficients affected by the dirty
+    /// rectangles are recomputed, bit-identical to a full [`forward`] of
+    /// `raw`. An input edit perturbs coefficients within the lifting support
+    /// radius `6 * (2^levels - 1)` around it, so each rectangle is expanded
+    /// by that radius to get the affected region, and the transform is redone
+    /// over a window extending one further radius out (overlap-save, as in
+    /// [`StripTransform`]) so the affected region comes out exact. Windows
+    /// are aligned to the `2^levels` grid and clamp to real plane edges,
+    /// where the boundary special cases are genuinely correct.
+    ///
+    /// For small edits the cost is O(window²) instead of O(plane).
+    ///
+    /// [`forward`]: Self::forward
+    pub fn forward_incremental(
+        coeffs: &mut [i16],
+        raw: &[i16],
+        w: usize,
+        h: usize,
+        rowsize: usize,
+        levels: usize,
+        dirty: &[DirtyRect],
+    ) {
+        let align = 1usize << levels;
+        let margin = (6 * (align - 1)).div_ceil(align) * align;
+
+        for rect in dirty {
+            if rect.w == 0 || rect.h == 0 {
+                continue;
+            }
+            // Affected coefficients: the edit expanded by the support radius.
+            let ax0 = rect.x.saturating_sub(margin) / align * align;
+            let ay0 = rect.y.saturating_sub(margin) / align * align;
+            let ax1 = (rect.x + rect.w + margin).min(w);
+            let ay1 = (rect.y + rect.h + margin).min(h);
+            // Recompute window: one further radius so the affected region is
+            // beyond the contamination of the artificial window edges.
+            let wx0 = ax0.saturating_sub(margin);
+            let wy0 = ay0.saturating_sub(margin);
+            let wx1 = ((ax1 + margin).div_ceil(align) * align).min(w);
+            let wy1 = ((ay1 + margin).div_ceil(align) * align).min(h);
+            let (ww, wh) = (wx1 - wx0, wy1 - wy0);
+
+            let mut scratch = vec![0i16; ww * wh];
+            for y in 0..wh {
+                let src = (wy0 + y) * rowsize + wx0;
+                scratch[y * ww..y * ww + ww].copy_from_slice(&raw[src..src + ww]);
+            }
+            Self::forward(&mut scratch, ww, wh, ww, levels);
+
+            for y in ay0..ay1 {
+                let src = (y - wy0) * ww + (ax0 - wx0);
+                let dst = y * rowsize + ax0;
+                coeffs[dst..dst + (ax1 - ax0)].copy_from_slice(&scratch[src..src + (ax1 - ax0)]);
+            }
+        }
+    }
+}
+
+/// Streaming forward transform over horizontal strips.
+///
+/// Holds only a sliding window of raw rows instead of the whole plane, so
+/// peak memory is O(strip) rather than O(image). Exactness comes from the
+/// bounded support of the lifting cascade: a transformed row depends on raw
+/// rows within `6 * scale` of it per level, so recomputing each strip with a
+/// margin of `6 * (2^levels - 1)` rows on both sides and discarding the
+/// margin reproduces the full-plane [`Encode::forward`] output bit for bit.
+/// Window starts are kept aligned to `2^levels` rows so every scale's row
+/// grid lines up with the full-plane computation.
+pub struct StripTransform {
+    w: usize,
+    h: usize,
+    /// Length of each stored row; equals `w` unless built with a stride.
+    rowsize: usize,
+    levels: usize,
+    /// Rows emitted per strip (multiple of `2^levels`).
+    strip: usize,
+    /// Overlap margin carried on each side of a strip (multiple of `2^levels`).
+    margin: usize,
+    /// Raw rows `[win_start, win_start + window.len() / rowsize)`, packed
+    /// at `rowsize` coefficients per row.
+    window: Vec<i16>,
+    /// Absolute index of the first row held in `window`.
+    win_start: usize,
+    /// Total rows pushed so far.
+    rows_in: usize,
+    /// Absolute index of the next row to transform and emit.
+    next_emit: usize,
+}
+
+impl StripTransform {
+    /// `strip_rows` trades memory for recompute overhead: each strip redoes
+    /// the transform over `strip + 2*margin` rows, so small strips pay a
+    /// larger relative margin cost. It is rounded up to the row-grid
+    /// alignment of `2^levels`.
+    pub fn new(w: usize, h: usize, levels: usize, strip_rows: usize) -> Self {
+        Self::with_stride(w, w, h, levels, strip_rows)
+    }
+
+    /// Like [`new`](Self::new), but rows carry `rowsize >= w` coefficients:
+    /// the transform covers columns `0..w` and the padding columns pass
+    /// through untouched, matching `forward()` on a padded plane.
+    pub fn with_stride(w: usize, rowsize: usize, h: usize, levels: usize, strip_rows: usize) -> Self {
+        debug_assert!(rowsize >= w);
+        let align = 1usize << levels;
+        let margin = (6 * (align - 1)).div_ceil(align) * align;
+        let strip = strip_rows.max(1).div_ceil(align) * align;
+        Self {
+            w,
+            h,
+            rowsize,
+            levels,
+            strip,
+            margin,
+            window: Vec::with_capacity(rowsize * (strip + 2 * margin).min(h.max(1))),
+            win_start: 0,
+            rows_in: 0,
+            next_emit: 0,
+        }
+    }
+
+    /// Feed the next raw row (top to bottom in plane order, `w` coefficients).
+    /// `sink` receives finalized rows as `(absolute_row_index, coefficients)`
+    /// whenever a strip completes; rows arrive in order.
+    pub fn push_row(&mut self, row: &[i16], sink: &mut impl FnMut(usize, &[i16])) {
+        debug_assert_eq!(row.len(), self.rowsize);
+        debug_assert!(self.rows_in < self.h);
+        self.window.extend_from_slice(row);
+        self.rows_in += 1;
+        // A strip is ready once its bottom margin is fully buffered.
+        while self.rows_in >= self.next_emit + self.strip + self.margin && self.next_emit < self.h {
+            let emit_end = self.next_emit + self.strip;
+            self.emit(emit_end, sink);
+        }
+    }
+
+    /// Transform and emit whatever remains. Must be called after the last
+    /// row; the final strip uses the real bottom boundary, so no margin is
+    /// discarded there.
+    pub fn finish(&mut self, sink: &mut impl FnMut(usize, &[i16])) {
+        debug_assert_eq!(self.rows_in, self.h);
+        while self.next_emit < self.h {
+            let emit_end = (self.next_emit + self.strip).min(self.h);
+            self.emit(emit_end, sink);
+        }
+    }
+
+    /// Transform the current window and hand rows `[next_emit, emit_end)` to
+    /// the sink, then slide the window forward.
+    fn emit(&mut self, emit_end: usize, sink: &mut impl FnMut(usize, &[i16])) {
+        let win_h = self.rows_in - self.win_start;
+        let mut scratch = self.window.clone();
+        Encode::forward(&mut scratch, self.w, win_h, self.rowsize, self.levels);
+        for y in self.next_emit..emit_end {
+            let off = (y - self.win_start) * self.rowsize;
+            sink(y, &scratch[off..off + self.rowsize]);
+        }
+        self.next_emit = emit_end;
+        // Keep `margin` raw rows behind the emit point; the window base stays
+        // aligned because strip, margin and the base are all multiples of
+        // 2^levels.
+        let new_start = self.next_emit.saturating_sub(self.margin);
+        let drop = (new_start - self.win_start) * self.rowsize;
+        if drop > 0 {
+            self.window.copy_within(drop.., 0);
+            let len = self.window.len() - drop;
+            self.window.truncate(len);
+            self.win_start = new_start;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Small deterministic RNG so the tests need no external crates.
+    struct XorShift(u64);
+    impl XorShift {
+        fn next(&mut self) -> u64 {
+            let mut x = self.0;
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            self.0 = x;
+            x
+        }
+        fn coeff(&mut self) -> i16 {
+            // Mix of typical and near-saturated values
+            (self.next() as i16) >> (self.next() % 4)
+        }
+    }
+
+    fn random_plane(w: usize, h: usize, seed: u64) -> Vec<i16> {
+        let mut rng = XorShift(seed | 1);
+        (0..w * h).map(|_| rng.coeff()).collect()
+    }
+
+    /// Runs the transform through the scalar-only code paths.
+    fn forward_scalar(buf: &mut [i16], w: usize, h: usize, rowsize: usize, levels: usize) {
+        let mut scale = 1;
+        for _ in 0..levels {
+            filter_fh_scalar(buf, w, h, rowsize, scale);
+            filter_fv_with(buf, w, h, rowsize, scale, None);
+            scale <<= 1;
+        }
+    }
+
+    #[test]
+    fn simd_horizontal_matches_scalar() {
+        for &w in &[16usize, 17, 31, 32, 33, 63, 100, 257] {
+            let plane = random_plane(w, 4, 0x1234 + w as u64);
+            let mut a = plane.clone();
+            let mut b = plane;
+            filter_fh(&mut a, w, 4, w, 1);
+            filter_fh_scalar(&mut b, w, 4, w, 1);
+            assert_eq!(a, b, "horizontal mismatch at w={}", w);
+        }
+    }
+
+    #[test]
+    fn simd_vertical_matches_scalar() {
+        for &(w, h) in &[(16usize, 16usize), (33, 20), (64, 64), (100, 37), (17, 100)] {
+            let plane = random_plane(w, h, 0x9876 + (w * h) as u64);
+            let mut a = plane.clone();
+            let mut b = plane;
+            filter_fv(&mut a, w, h, w, 1);
+            filter_fv_with(&mut b, w, h, w, 1, None);
+            assert_eq!(a, b, "vertical mismatch at {}x{}", w, h);
+        }
+    }
+
+    #[cfg(feature = "rayon")]
+    #[test]
+    fn parallel_forward_matches_scalar() {
+        for &(w, h) in &[(64usize, 64usize), (130, 70), (257, 193)] {
+            let plane = random_plane(w, h, 0x5151 + (w + h) as u64);
+            let mut a = plane.clone();
+            let mut b = plane;
+            Encode::forward_parallel(&mut a, w, h, w, 5);
+            forward_scalar(&mut b, w, h, w, 5);
+            assert_eq!(a, b, "parallel mismatch at {}x{}", w, h);
+        }
+    }
+
+    #[test]
+    fn fused_forward_matches_scalar() {
+        for &(w, h) in &[(16usize, 16usize), (33, 20), (64, 48), (100, 37), (130, 70)] {
+            let plane = random_plane(w, h, 0x7777 + (w * h) as u64);
+            let mut a = plane.clone();
+            let mut b = plane;
+            Encode::forward_fused(&mut a, w, h, w, 5);
+            forward_scalar(&mut b, w, h, w, 5);
+            assert_eq!(a, b, "fused mismatch at {}x{}", w, h);
+        }
+    }
+
+    #[test]
+    fn saturating_forward_clamps_instead_of_wrapping() {
+        // In-range planes: identical output to the default scalar transform.
+        for &(w, h) in &[(48usize, 40usize), (33, 21)] {
+            let damped: Vec<i16> = random_plane(w, h, 0xfeed + w as u64)
+                .iter()
+                .map(|&v| v >> 6)
+                .collect();
+            let mut a = damped.clone();
+            let mut b = damped;
+            forward_scalar(&mut a, w, h, w, 5);
+            Encode::forward_saturating(&mut b, w, h, w, 5);
+            assert_eq!(a, b, "in-range plane must be unaffected at {}x{}", w, h);
+        }
+
+        // Extreme checkerboard row: the first prediction result is -65535,
+        // which the wrapping store folds to +1 (a sign flip); the saturating
+        // store pins it at the rail.
+        let w = 8;
+        let row: Vec<i16> = (0..w)
+            .map(|i| if i % 2 == 0 { 32767 } else { -32768 })
+            .collect();
+        let mut wrap = row.clone();
+        let mut sat = row;
+        forward_scalar(&mut wrap, w, 1, w, 1);
+        Encode::forward_saturating(&mut sat, w, 1, w, 1);
+        assert_eq!(wrap[1], 1, "wrapping store folds the overflow");
+        assert_eq!(sat[1], -32768, "saturating store clamps it");
+    }
+
+    #[test]
+    fn incremental_forward_matches_full_recompute() {
+        // (w, h, levels, edit rect) — large plane where the recompute window
+        // stays well inside, plus a small plane where everything clamps.
+        for &(w, h, levels, rx, ry, rw, rh) in &[
+            (1100usize, 900usize, 5usize, 507usize, 413usize, 30usize, 25usize),
+            (1100, 900, 5, 0, 0, 10, 10), // corner edit, windows clamp at 0
+            (96, 80, 3, 40, 33, 7, 5),    // window covers most of the plane
+        ] {
+            let old_raw = random_plane(w, h, 0xd1e5 ^ (rx as u64) << 20);
+            let mut new_raw = old_raw.clone();
+            let mut rng = XorShift(0x77aa ^ (ry as u64));
+            for y in ry..ry + rh {
+                for x in rx..rx + rw {
+                    new_raw[y * w + x] = rng.coeff();
+                }
+            }
+
+            let mut coeffs = old_raw.clone();
+            Encode::forward(&mut coeffs, w, h, w, levels);
+            let mut expected = new_raw.clone();
+            Encode::forward(&mut expected, w, h, w, levels);
+
+            let dirty = [DirtyRect { x: rx, y: ry, w: rw, h: rh }];
+            Encode::forward_incremental(&mut coeffs, &new_raw, w, h, w, levels, &dirty);
+            assert_eq!(coeffs, expected, "incremental mismatch at {}x{} lvl {}", w, h, levels);
         }
+    }
+
+    #[test]
+    fn strip_transform_matches_full_forward() {
+        // Heights straddling the strip/margin boundaries, including planes
+        // shorter than one strip and a height that is not 2^levels-aligned.
+        for &(w, h, levels, strip) in &[
+            (48usize, 700usize, 5usize, 64usize),
+            (33, 197, 5, 32),
+            (64, 96, 5, 512),
+            (40, 300, 3, 50),
+        ] {
+            let plane = random_plane(w, h, 0x1234_5678 ^ (w * h) as u64);
+            let mut expected = plane.clone();
+            forward_scalar(&mut expected, w, h, w, levels);
+
+            let mut got = vec![0i16; w * h];
+            let mut seen = 0usize;
+            let mut st = StripTransform::new(w, h, levels, strip);
+            {
+                let mut sink = |y: usize, row: &[i16]| {
+                    assert_eq!(y, seen, "rows must arrive in order");
+                    got[y * w..y * w + w].copy_from_slice(row);
+                    seen += 1;
+                };
+                for y in 0..h {
+                    st.push_row(&plane[y * w..y * w + w], &mut sink);
+                }
+                st.finish(&mut sink);
+            }
+            assert_eq!(seen, h);
+            assert_eq!(got, expected, "strip mismatch at {}x{} levels={}", w, h, levels);
+        }
+    }
+
+    #[test]
+    fn forward_with_stats_matches_and_records_each_scale() {
+        let (w, h) = (64usize, 48usize);
+        let plane = random_plane(w, h, 0x5151);
+        let mut a = plane.clone();
+        let mut b = plane;
+        let mut stats = TransformStats::default();
+        Encode::forward_with_stats(&mut a, w, h, w, 5, &mut stats);
+        forward_scalar(&mut b, w, h, w, 5);
+        assert_eq!(a, b);
+        assert_eq!(stats.scales.len(), 5);
+        for (i, s) in stats.scales.iter().enumerate() {
+            assert_eq!(s.scale, 1 << i);
+            assert!(s.bytes_touched > 0);
+        }
+        assert_eq!(
+            stats.bytes_touched(),
+            stats.scales.iter().map(|s| s.bytes_touched).sum::<usize>()
+        );
+    }
 
-        // y is in the scaled coordinate system because hlimit = ceil(h/scale)
-        // (matches C++: y += 2)
-        y += 2;
-        p += s + s;
+    #[test]
+    fn forward_matches_scalar_pipeline() {
+        for &(w, h) in &[(32usize, 32usize), (64, 48), (96, 96), (130, 70)] {
+            let plane = random_plane(w, h, 0xdead_beef);
+            let mut a = plane.clone();
+            let mut b = plane;
+            Encode::forward(&mut a, w, h, w, 5);
+            forward_scalar(&mut b, w, h, w, 5);
+            assert_eq!(a, b, "forward mismatch at {}x{}", w, h);
+        }
     }
 }
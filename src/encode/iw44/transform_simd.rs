@@ -0,0 +1,445 @@
+// src/encode/iw44/transform_simd.rs
+
+//! Runtime-dispatched SIMD kernels for the IW44 lifting filters.
+//!
+//! These cover the generic (non-boundary) prediction and update passes of
+//! `filter_fv` and `filter_fh` at `scale == 1`, which is where the forward
+//! transform spends roughly three quarters of its time. Boundary rows and
+//! columns, coarser scales, and non-x86 targets all fall back to the scalar
+//! code in `transform.rs`.
+//!
+//! All kernels are bit-exact with the scalar loops: intermediates are i32 and
+//! results are stored with a truncating (wrapping) cast to i16, matching the
+//! `as i16` casts in the scalar code.
+
+#![cfg(target_arch = "x86_64")]
+
+use std::arch::x86_64::*;
+
+/// Instruction set selected at runtime.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub(super) enum Isa {
+    Avx2,
+    Sse41,
+}
+
+/// Detects the best available instruction set, or `None` to use scalar code.
+#[inline]
+pub(super) fn detect() -> Option<Isa> {
+    if is_x86_feature_detected!("avx2") {
+        Some(Isa::Avx2)
+    } else if is_x86_feature_detected!("sse4.1") {
+        Some(Isa::Sse41)
+    } else {
+        None
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Vertical filter (scale == 1): rows are contiguous, so we widen 8 coefficients
+// at a time to i32 lanes, apply the lifting step, and truncate back to i16.
+// ---------------------------------------------------------------------------
+
+/// Generic vertical prediction for one full row at scale 1.
+///
+/// Computes `buf[q] -= (9*(buf[q-s]+buf[q+s]) - (buf[q-s3]+buf[q+s3]) + 8) >> 4`
+/// for `q` in `p..p+w`, where `s == rowsize`. The caller guarantees the row is
+/// a generic row (`y >= 3 && y + 3 < hlimit`), so all neighbor rows exist.
+///
+/// # Safety
+/// `buf.add(i)` must be valid for reads and writes and unaliased for the
+/// row at `p` and its four neighbor rows (`p ± rowsize`, `p ± 3*rowsize`),
+/// each `w` elements wide.
+pub(super) unsafe fn fv_predict_row(isa: Isa, buf: *mut i16, p: usize, w: usize, rowsize: usize) {
+    unsafe {
+        match isa {
+            Isa::Avx2 => fv_row_avx2::<false>(buf, p, w, rowsize),
+            Isa::Sse41 => fv_row_sse41::<false>(buf, p, w, rowsize),
+        }
+    }
+}
+
+/// Generic vertical update for one full row at scale 1.
+///
+/// Computes `buf[q] += (9*(buf[q-s]+buf[q+s]) - (buf[q-s3]+buf[q+s3]) + 16) >> 5`
+/// for `q` in `p..p+w`. The caller guarantees a generic row (`y >= 6 && y < hlimit`).
+///
+/// # Safety
+/// Same contract as [`fv_predict_row`].
+pub(super) unsafe fn fv_update_row(isa: Isa, buf: *mut i16, p: usize, w: usize, rowsize: usize) {
+    unsafe {
+        match isa {
+            Isa::Avx2 => fv_row_avx2::<true>(buf, p, w, rowsize),
+            Isa::Sse41 => fv_row_sse41::<true>(buf, p, w, rowsize),
+        }
+    }
+}
+
+#[target_feature(enable = "avx2")]
+unsafe fn fv_row_avx2<const UPDATE: bool>(base: *mut i16, p: usize, w: usize, rowsize: usize) {
+    unsafe {
+        let s = rowsize;
+        let s3 = 3 * rowsize;
+        let mut x = 0usize;
+        while x + 8 <= w {
+            let q = p + x;
+            // Widen 8 i16 coefficients from each involved row to i32 lanes.
+            let load = |off: usize| -> __m256i {
+                _mm256_cvtepi16_epi32(_mm_loadu_si128(base.add(off) as *const __m128i))
+            };
+            let a = _mm256_add_epi32(load(q - s), load(q + s));
+            let b = _mm256_add_epi32(load(q - s3), load(q + s3));
+            let cur = load(q);
+            let nine_a = _mm256_add_epi32(_mm256_slli_epi32(a, 3), a);
+            let t = if UPDATE {
+                let v = _mm256_srai_epi32(
+                    _mm256_add_epi32(_mm256_sub_epi32(nine_a, b), _mm256_set1_epi32(16)),
+                    5,
+                );
+                _mm256_add_epi32(cur, v)
+            } else {
+                let v = _mm256_srai_epi32(
+                    _mm256_add_epi32(_mm256_sub_epi32(nine_a, b), _mm256_set1_epi32(8)),
+                    4,
+                );
+                _mm256_sub_epi32(cur, v)
+            };
+            _mm_storeu_si128(base.add(q) as *mut __m128i, trunc_pack_avx2(t));
+            x += 8;
+        }
+        // Scalar tail
+        while x < w {
+            let q = p + x;
+            let a = *base.add(q - s) as i32 + *base.add(q + s) as i32;
+            let b = *base.add(q - s3) as i32 + *base.add(q + s3) as i32;
+            let cur = *base.add(q) as i32;
+            let r = if UPDATE {
+                cur + (((a << 3) + a - b + 16) >> 5)
+            } else {
+                cur - (((a << 3) + a - b + 8) >> 4)
+            };
+            *base.add(q) = r as i16;
+            x += 1;
+        }
+    }
+}
+
+#[target_feature(enable = "sse4.1")]
+unsafe fn fv_row_sse41<const UPDATE: bool>(base: *mut i16, p: usize, w: usize, rowsize: usize) {
+    unsafe {
+        let s = rowsize;
+        let s3 = 3 * rowsize;
+        let mut x = 0usize;
+        while x + 4 <= w {
+            let q = p + x;
+            let load = |off: usize| -> __m128i {
+                _mm_cvtepi16_epi32(_mm_loadl_epi64(base.add(off) as *const __m128i))
+            };
+            let a = _mm_add_epi32(load(q - s), load(q + s));
+            let b = _mm_add_epi32(load(q - s3), load(q + s3));
+            let cur = load(q);
+            let nine_a = _mm_add_epi32(_mm_slli_epi32(a, 3), a);
+            let t = if UPDATE {
+                let v = _mm_srai_epi32(
+                    _mm_add_epi32(_mm_sub_epi32(nine_a, b), _mm_set1_epi32(16)),
+                    5,
+                );
+                _mm_add_epi32(cur, v)
+            } else {
+                let v = _mm_srai_epi32(
+                    _mm_add_epi32(_mm_sub_epi32(nine_a, b), _mm_set1_epi32(8)),
+                    4,
+                );
+                _mm_sub_epi32(cur, v)
+            };
+            _mm_storel_epi64(base.add(q) as *mut __m128i, trunc_pack_sse(t));
+            x += 4;
+        }
+        while x < w {
+            let q = p + x;
+            let a = *base.add(q - s) as i32 + *base.add(q + s) as i32;
+            let b = *base.add(q - s3) as i32 + *base.add(q + s3) as i32;
+            let cur = *base.add(q) as i32;
+            let r = if UPDATE {
+                cur + (((a << 3) + a - b + 16) >> 5)
+            } else {
+                cur - (((a << 3) + a - b + 8) >> 4)
+            };
+            *base.add(q) = r as i16;
+            x += 1;
+        }
+    }
+}
+
+/// Truncates 8 i32 lanes to 8 i16 (wrapping, like `as i16`).
+#[target_feature(enable = "avx2")]
+#[inline]
+unsafe fn trunc_pack_avx2(v: __m256i) -> __m128i {
+    // Mask to the low 16 bits so the unsigned-saturating pack passes values
+    // through unchanged, then fix up the 128-bit lane split.
+    let masked = _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+    let packed = _mm256_packus_epi32(masked, masked);
+    let fixed = _mm256_permute4x64_epi64(packed, 0b11_01_10_00);
+    _mm256_castsi256_si128(fixed)
+}
+
+/// Truncates 4 i32 lanes to 4 i16 (wrapping, like `as i16`).
+#[target_feature(enable = "sse4.1")]
+#[inline]
+unsafe fn trunc_pack_sse(v: __m128i) -> __m128i {
+    let masked = _mm_and_si128(v, _mm_set1_epi32(0xffff));
+    _mm_packus_epi32(masked, masked)
+}
+
+// ---------------------------------------------------------------------------
+// Horizontal filter (scale == 1): the row is processed in two phases that are
+// equivalent to the streaming scalar loop — predict all odd positions (which
+// read only original even-position values), then update all even positions.
+// The streaming code carries predictions in untruncated i32 registers, so the
+// predictions are kept in an i32 scratch row for the update phase; `buf` gets
+// the truncated i16 like the scalar code. Within a phase, values of one parity
+// are extracted from interleaved (even, odd) i32 word pairs with a shift
+// trick, so no gathers are needed.
+// ---------------------------------------------------------------------------
+
+/// Applies the horizontal lifting filter to one row at scale 1.
+///
+/// `scratch` holds the untruncated odd-position predictions; it must be
+/// `w / 2 + 4` long with the two leading and trailing slots kept at zero
+/// (out-of-row neighbors contribute 0, like the scalar b-registers).
+/// Requires `w >= 16`; smaller rows use the scalar streaming code.
+pub(super) fn fh_row(isa: Isa, buf: &mut [i16], p: usize, w: usize, scratch: &mut [i32]) {
+    debug_assert!(w >= 16);
+    debug_assert!(scratch.len() == w / 2 + 4);
+
+    // --- Phase 1: predict odd positions (x = 2k + 1 -> scratch[k + 2]) ---
+    // x == 1 uses the simple average, like the scalar prologue.
+    {
+        let a1 = buf[p] as i32;
+        let a2 = buf[p + 2] as i32;
+        let b = (buf[p + 1] as i32) - ((a1 + a2 + 1) >> 1);
+        scratch[2] = b;
+        buf[p + 1] = b as i16;
+    }
+    // Generic odd positions 3 <= x, x + 3 < w: SIMD bulk, then scalar remainder.
+    let mut x = 3usize;
+    unsafe {
+        match isa {
+            Isa::Avx2 => x = fh_predict_avx2(buf, p, w, x, scratch),
+            Isa::Sse41 => x = fh_predict_sse41(buf, p, w, x, scratch),
+        }
+    }
+    while x + 3 < w {
+        let a0 = buf[p + x - 3] as i32;
+        let a1 = buf[p + x - 1] as i32;
+        let a2 = buf[p + x + 1] as i32;
+        let a3 = buf[p + x + 3] as i32;
+        let b = (buf[p + x] as i32) - ((((a1 + a2) << 3) + (a1 + a2) - a0 - a3 + 8) >> 4);
+        scratch[x / 2 + 2] = b;
+        buf[p + x] = b as i16;
+        x += 2;
+    }
+    // Tail odd positions (x + 3 >= w): simple average with edge replication,
+    // matching the scalar epilogue's shift-register behavior.
+    while x < w {
+        let a1 = buf[p + x - 1] as i32;
+        let a2 = if x + 1 < w {
+            buf[p + x + 1] as i32
+        } else {
+            buf[p + x - 1] as i32
+        };
+        let b = (buf[p + x] as i32) - ((a1 + a2 + 1) >> 1);
+        scratch[x / 2 + 2] = b;
+        buf[p + x] = b as i16;
+        x += 2;
+    }
+
+    // --- Phase 2: update even positions x = 2k from scratch[k .. k + 4] ---
+    let mut x = unsafe {
+        match isa {
+            Isa::Avx2 => fh_update_avx2(buf, p, w, scratch),
+            Isa::Sse41 => fh_update_sse41(buf, p, w, scratch),
+        }
+    };
+    while x < w {
+        let k = x / 2;
+        let d1 = scratch[k + 1] + scratch[k + 2]; // b1 + b2
+        let d2 = scratch[k] + scratch[k + 3]; // b0 + b3
+        buf[p + x] = ((buf[p + x] as i32) + (((d1 << 3) + d1 - d2 + 16) >> 5)) as i16;
+        x += 2;
+    }
+}
+
+/// Sign-extends the even (low) i16 of each 32-bit word pair to i32 lanes.
+#[target_feature(enable = "avx2")]
+#[inline]
+unsafe fn even_lanes_avx2(v: __m256i) -> __m256i {
+    _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16)
+}
+
+/// Sign-extends the odd (high) i16 of each 32-bit word pair to i32 lanes.
+#[target_feature(enable = "avx2")]
+#[inline]
+unsafe fn odd_lanes_avx2(v: __m256i) -> __m256i {
+    _mm256_srai_epi32(v, 16)
+}
+
+/// SIMD bulk of the odd-position prediction. `x` is the first odd position to
+/// process; returns the first odd position left for the scalar remainder.
+#[target_feature(enable = "avx2")]
+unsafe fn fh_predict_avx2(
+    buf: &mut [i16],
+    p: usize,
+    w: usize,
+    mut x: usize,
+    scratch: &mut [i32],
+) -> usize {
+    unsafe {
+        let base = buf.as_mut_ptr();
+        let sbase = scratch.as_mut_ptr();
+        // Pair k holds elements (2k, 2k+1); predicting x = 2k+1 reads even values
+        // at pairs k-1 .. k+2. A vector step covers pairs k .. k+7 and reads up to
+        // element 2k+19, which must stay inside the row.
+        while x + 18 < w {
+            let k = x / 2;
+            let load = |pk: usize| _mm256_loadu_si256(base.add(p + 2 * pk) as *const __m256i);
+            let e_m1 = even_lanes_avx2(load(k - 1));
+            let v0 = load(k);
+            let e0 = even_lanes_avx2(v0);
+            let e1 = even_lanes_avx2(load(k + 1));
+            let e2 = even_lanes_avx2(load(k + 2));
+            let a12 = _mm256_add_epi32(e0, e1); // a1 + a2
+            let a03 = _mm256_add_epi32(e_m1, e2); // a0 + a3
+            let nine = _mm256_add_epi32(_mm256_slli_epi32(a12, 3), a12);
+            let t = _mm256_srai_epi32(
+                _mm256_add_epi32(_mm256_sub_epi32(nine, a03), _mm256_set1_epi32(8)),
+                4,
+            );
+            let newodd = _mm256_sub_epi32(odd_lanes_avx2(v0), t);
+            // Keep the untruncated predictions for the update phase.
+            _mm256_storeu_si256(sbase.add(k + 2) as *mut __m256i, newodd);
+            // Keep even halves, replace odd halves with the (wrapped) prediction.
+            let out = _mm256_or_si256(
+                _mm256_and_si256(v0, _mm256_set1_epi32(0xffff)),
+                _mm256_slli_epi32(newodd, 16),
+            );
+            _mm256_storeu_si256(base.add(p + 2 * k) as *mut __m256i, out);
+            x += 16;
+        }
+        x
+    }
+}
+
+/// SIMD bulk of the even-position update; returns the first even position
+/// left for the scalar remainder.
+#[target_feature(enable = "avx2")]
+unsafe fn fh_update_avx2(buf: &mut [i16], p: usize, w: usize, scratch: &[i32]) -> usize {
+    unsafe {
+        let base = buf.as_mut_ptr();
+        let sbase = scratch.as_ptr();
+        let mut x = 0usize;
+        // Updating x = 2k reads scratch[k .. k+10]; the zero padding makes the
+        // generic formula valid at the row edges, so the loop starts at x = 0.
+        while x + 16 <= w {
+            let k = x / 2;
+            let sload = |i: usize| _mm256_loadu_si256(sbase.add(k + i) as *const __m256i);
+            let v0 = _mm256_loadu_si256(base.add(p + 2 * k) as *const __m256i);
+            let d1 = _mm256_add_epi32(sload(1), sload(2)); // b1 + b2
+            let d2 = _mm256_add_epi32(sload(0), sload(3)); // b0 + b3
+            let nine = _mm256_add_epi32(_mm256_slli_epi32(d1, 3), d1);
+            let t = _mm256_srai_epi32(
+                _mm256_add_epi32(_mm256_sub_epi32(nine, d2), _mm256_set1_epi32(16)),
+                5,
+            );
+            let neweven = _mm256_add_epi32(even_lanes_avx2(v0), t);
+            let out = _mm256_or_si256(
+                _mm256_and_si256(neweven, _mm256_set1_epi32(0xffff)),
+                _mm256_andnot_si256(_mm256_set1_epi32(0xffff), v0),
+            );
+            _mm256_storeu_si256(base.add(p + 2 * k) as *mut __m256i, out);
+            x += 16;
+        }
+        x
+    }
+}
+
+#[target_feature(enable = "sse4.1")]
+#[inline]
+unsafe fn even_lanes_sse(v: __m128i) -> __m128i {
+    _mm_srai_epi32(_mm_slli_epi32(v, 16), 16)
+}
+
+#[target_feature(enable = "sse4.1")]
+#[inline]
+unsafe fn odd_lanes_sse(v: __m128i) -> __m128i {
+    _mm_srai_epi32(v, 16)
+}
+
+#[target_feature(enable = "sse4.1")]
+unsafe fn fh_predict_sse41(
+    buf: &mut [i16],
+    p: usize,
+    w: usize,
+    mut x: usize,
+    scratch: &mut [i32],
+) -> usize {
+    unsafe {
+        let base = buf.as_mut_ptr();
+        let sbase = scratch.as_mut_ptr();
+        // 128-bit step: pairs k .. k+3, reads up to element 2k+11.
+        while x + 10 < w {
+            let k = x / 2;
+            let load = |pk: usize| _mm_loadu_si128(base.add(p + 2 * pk) as *const __m128i);
+            let e_m1 = even_lanes_sse(load(k - 1));
+            let v0 = load(k);
+            let e0 = even_lanes_sse(v0);
+            let e1 = even_lanes_sse(load(k + 1));
+            let e2 = even_lanes_sse(load(k + 2));
+            let a12 = _mm_add_epi32(e0, e1);
+            let a03 = _mm_add_epi32(e_m1, e2);
+            let nine = _mm_add_epi32(_mm_slli_epi32(a12, 3), a12);
+            let t = _mm_srai_epi32(
+                _mm_add_epi32(_mm_sub_epi32(nine, a03), _mm_set1_epi32(8)),
+                4,
+            );
+            let newodd = _mm_sub_epi32(odd_lanes_sse(v0), t);
+            _mm_storeu_si128(sbase.add(k + 2) as *mut __m128i, newodd);
+            let out = _mm_or_si128(
+                _mm_and_si128(v0, _mm_set1_epi32(0xffff)),
+                _mm_slli_epi32(newodd, 16),
+            );
+            _mm_storeu_si128(base.add(p + 2 * k) as *mut __m128i, out);
+            x += 8;
+        }
+        x
+    }
+}
+
+#[target_feature(enable = "sse4.1")]
+unsafe fn fh_update_sse41(buf: &mut [i16], p: usize, w: usize, scratch: &[i32]) -> usize {
+    unsafe {
+        let base = buf.as_mut_ptr();
+        let sbase = scratch.as_ptr();
+        let mut x = 0usize;
+        while x + 8 <= w {
+            let k = x / 2;
+            let sload = |i: usize| _mm_loadu_si128(sbase.add(k + i) as *const __m128i);
+            let v0 = _mm_loadu_si128(base.add(p + 2 * k) as *const __m128i);
+            let d1 = _mm_add_epi32(sload(1), sload(2));
+            let d2 = _mm_add_epi32(sload(0), sload(3));
+            let nine = _mm_add_epi32(_mm_slli_epi32(d1, 3), d1);
+            let t = _mm_srai_epi32(
+                _mm_add_epi32(_mm_sub_epi32(nine, d2), _mm_set1_epi32(16)),
+                5,
+            );
+            let neweven = _mm_add_epi32(even_lanes_sse(v0), t);
+            let out = _mm_or_si128(
+                _mm_and_si128(neweven, _mm_set1_epi32(0xffff)),
+                _mm_andnot_si128(_mm_set1_epi32(0xffff), v0),
+            );
+            _mm_storeu_si128(base.add(p + 2 * k) as *mut __m128i, out);
+            x += 8;
+        }
+        x
+    }
+}
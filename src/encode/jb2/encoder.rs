@@ -239,7 +239,7 @@ impl<W: Write> JB2Encoder<W> {
 
         // Create ZP encoder (djvu_compat = true for JB2)
         // Pass buffer by value so we can get it back from finish()
-        let mut zc = ZEncoder::new(buffer, true)?;
+        let mut zc = ZEncoder::new_const::<true>(buffer)?;
 
         // Encode start of image record
         self.encode_start_of_image(&mut zc)?;
@@ -735,7 +735,7 @@ impl<W: Write> JB2Encoder<W> {
         self.gotstartrecordp = false;
 
         let buffer = Vec::new();
-        let mut zc = ZEncoder::new(buffer, true)?;
+        let mut zc = ZEncoder::new_const::<true>(buffer)?;
 
         // Emit REQUIRED_DICT_OR_RESET if there's an inherited dictionary
         if inherited_shape_count > 0 {
@@ -1000,7 +1000,7 @@ impl<W: Write> JB2Encoder<W> {
         self.gotstartrecordp = false;
 
         let buffer = Vec::new();
-        let mut zc = ZEncoder::new(buffer, true)?;
+        let mut zc = ZEncoder::new_const::<true>(buffer)?;
 
         self.image_width = width;
         self.image_height = height;
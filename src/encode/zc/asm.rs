@@ -64,6 +64,9 @@ pub extern "C" fn zp_debug_hook(event: i32, a: u32, subend: u32, buffer: u32, nr
     }
 }
 
+// Entry points provided per target: zpcodec_fixed.asm (x86-64, NASM) or
+// zpcodec_fixed_aarch64.s (AArch64, GNU as). Both define this shared symbol
+// set against the same ZpAsmState layout.
 extern "C" {
     fn zpcodec_einit(state: *mut ZpAsmState);
     fn zpcodec_zemit(state: *mut ZpAsmState, b: i32);
@@ -73,6 +76,12 @@ extern "C" {
     fn zpcodec_encode_mps_simple(state: *mut ZpAsmState, z: u32);
     fn zpcodec_encode_lps_simple(state: *mut ZpAsmState, z: u32);
     fn zpcodec_eflush(state: *mut ZpAsmState);
+    /// Fused hot path: context load, interval update, up/dn adaptation and
+    /// inline emission in one call; skips the per-bit debug hook. Defined
+    /// only in the NASM file — the AArch64 port still uses the split
+    /// zpcodec_encode_mps/zpcodec_encode_lps sequence above.
+    #[cfg(target_arch = "x86_64")]
+    fn zpcodec_encode_bit(state: *mut ZpAsmState, ctx: *mut u8, bit: i32);
 }
 
 // Track bytes written for debugging
@@ -155,8 +164,41 @@ impl ZEncoder<Cursor<Vec<u8>>> {
         })
     }
 
+    #[cfg(target_arch = "x86_64")]
     #[inline(always)]
     pub fn encode(&mut self, bit: bool, ctx: &mut BitContext) -> Result<(), ZCodecError> {
+        // Fused asm entry: z computation, MPS/LPS dispatch, adaptation and
+        // emission all happen inside zpcodec_encode_bit, so the hot loop
+        // makes one call per bit instead of one per renormalization step.
+        unsafe {
+            zpcodec_encode_bit(&mut self.state, ctx as *mut u8, bit as i32);
+        }
+        Ok(())
+    }
+
+    /// Split-call path for targets without the fused entry point (AArch64):
+    /// same dispatch as the x86-64 fused call, one symbol per branch.
+    #[cfg(not(target_arch = "x86_64"))]
+    #[inline(always)]
+    pub fn encode(&mut self, bit: bool, ctx: &mut BitContext) -> Result<(), ZCodecError> {
+        let z = self.state.a.wrapping_add(self.state.p[*ctx as usize]);
+        let mps = (*ctx & 1) != 0;
+        unsafe {
+            if bit != mps {
+                zpcodec_encode_lps(&mut self.state, ctx as *mut u8, z);
+            } else if z >= 0x8000 {
+                zpcodec_encode_mps(&mut self.state, ctx as *mut u8, z);
+            } else {
+                self.state.a = z & 0xffff;
+            }
+        }
+        Ok(())
+    }
+
+    /// Split-call variant kept for the `dev_asm_cmp` comparison harness: it
+    /// routes through the hooked zemit/outbit path for step-level tracing.
+    #[cfg(feature = "dev_asm_cmp")]
+    pub fn encode_traced(&mut self, bit: bool, ctx: &mut BitContext) -> Result<(), ZCodecError> {
         // Compute z = a + p[ctx]
         let z = self.state.a.wrapping_add(self.state.p[*ctx as usize]);
         let mps = (*ctx & 1) != 0;
@@ -1,5 +1,7 @@
 #[cfg(feature = "asm_zp")]
 pub mod asm;
+pub mod arena;
+pub mod prime;
 pub mod table;
 pub mod zcodec;
 
@@ -18,6 +20,14 @@ use std::io::Cursor;
 pub trait ZpEncoderCursor {
     fn encode(&mut self, bit: bool, ctx: &mut BitContext) -> Result<(), ZCodecError>;
     fn iwencoder(&mut self, bit: bool) -> Result<(), ZCodecError>;
+    /// Encodes a run of significance bits; implementations override the
+    /// per-bit default when they can keep coder state live across the run.
+    fn iwencode_run(&mut self, bits: &[bool]) -> Result<(), ZCodecError> {
+        for &bit in bits {
+            self.iwencoder(bit)?;
+        }
+        Ok(())
+    }
     fn encode_raw_bit(&mut self, bit: bool) -> Result<(), ZCodecError>;
     fn tell_bytes(&self) -> usize;
     fn finish(self) -> Result<Cursor<Vec<u8>>, ZCodecError>
@@ -0,0 +1,151 @@
+//! Probability-to-state priming for [`BitContext`] arrays.
+//!
+//! A fresh context byte of 0 models p(1) = 0.5, so a coder pays the full
+//! adaptation ramp on every new context table even when the caller already
+//! knows the symbol statistics. djvulibre exposes `ZPCodec::state(float)` for
+//! this, but flags it "quite slow": every lookup walks the steady chain of
+//! the adaptation table and recomputes a logarithm per bisection step.
+//! [`StatePrimer`] ports that routine and hoists the logarithms: the LPS cost
+//! of each table entry is evaluated once at construction, after which whole
+//! context arrays are filled with comparisons and table lookups only.
+
+use super::table::ZpTableEntry;
+use super::zcodec::{BitContext, select_table};
+
+/// LPS coding cost of a table entry, in nats (upstream `p_to_plps`,
+/// ZPCODER variant).
+fn p_to_plps(p: u16) -> f64 {
+    let fp = f64::from(p) / 65536.0;
+    let log2 = std::f64::consts::LN_2;
+    if fp <= 1.0 / 6.0 {
+        fp * 2.0 * log2
+    } else {
+        (1.5 * fp - 0.25) - (1.5 * fp + 0.25) * (1.5 * fp + 0.25).ln()
+            + (0.5 * fp - 0.25) * log2
+    }
+}
+
+/// Reusable probability-to-state mapping over one adaptation table.
+///
+/// Construction evaluates the per-entry LPS costs once; [`state`](Self::state)
+/// and [`prime`](Self::prime) then run the steady-chain bisection without any
+/// transcendental math. Build one primer per compatibility mode and reuse it
+/// across pages.
+pub struct StatePrimer {
+    table: &'static [ZpTableEntry; 256],
+    /// `p_to_plps` of each table entry, indexed by state.
+    plps: [f64; 256],
+}
+
+impl StatePrimer {
+    pub fn new(djvu_compat: bool) -> Self {
+        let table = select_table(djvu_compat);
+        let mut plps = [0.0; 256];
+        for (cost, entry) in plps.iter_mut().zip(table.iter()) {
+            *cost = p_to_plps(entry.p);
+        }
+        Self { table, plps }
+    }
+
+    /// Returns the steady-chain state whose LPS cost is closest to coding a
+    /// bit with probability `prob1` of being 1. Port of `ZPCodec::state`.
+    pub fn state(&self, prob1: f32) -> BitContext {
+        let mps = prob1 > 0.5;
+        let plps = if mps {
+            1.0 - f64::from(prob1)
+        } else {
+            f64::from(prob1)
+        };
+        // Locate the steady chain (p strictly decreasing along it).
+        let mut lo = if mps { 1 } else { 2 };
+        let mut sz = 0;
+        while self.table[lo + sz + sz + 2].p < self.table[lo + sz + sz].p {
+            sz += 1;
+        }
+        // Bisection over the precomputed costs.
+        while sz > 1 {
+            let nsz = sz >> 1;
+            if self.plps[lo + nsz + nsz] < plps {
+                sz = nsz;
+            } else {
+                lo += nsz + nsz;
+                sz -= nsz;
+            }
+        }
+        // Choose the closer of the two bracketing states.
+        let f1 = self.plps[lo] - plps;
+        let f2 = plps - self.plps[lo + 2];
+        if f1 < f2 { lo as BitContext } else { (lo + 2) as BitContext }
+    }
+
+    /// Fills a context array from per-element probabilities in one pass.
+    /// `dst` and `probs` must have equal length.
+    pub fn prime(&self, dst: &mut [BitContext], probs: &[f32]) {
+        assert_eq!(dst.len(), probs.len(), "one probability per context");
+        for (ctx, &p) in dst.iter_mut().zip(probs) {
+            *ctx = self.state(p);
+        }
+    }
+}
+
+/// Seeds a context block from an already-trained one of the same shape —
+/// e.g. reusing the dictionary contexts of the previous page instead of
+/// re-deriving probabilities. Lengths must match, as in [`StatePrimer::prime`].
+pub fn clone_trained(dst: &mut [BitContext], src: &[BitContext]) {
+    dst.copy_from_slice(src);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn states_sit_on_the_right_chain_and_track_skew() {
+        for &compat in &[false, true] {
+            let primer = StatePrimer::new(compat);
+            // MPS bit of the returned state matches the dominant symbol.
+            assert_eq!(primer.state(0.9) & 1, 1);
+            assert_eq!(primer.state(0.1) & 1, 0);
+            assert_eq!(primer.state(0.5) & 1, 0);
+
+            // Stronger skew never maps to a cheaper-to-miss state.
+            let mut last = f64::INFINITY;
+            let mut prob = 0.5f32;
+            while prob > 1e-4 {
+                let cost = primer.plps[primer.state(prob) as usize];
+                assert!(cost <= last, "plps must be non-increasing with skew");
+                last = cost;
+                prob *= 0.7;
+            }
+
+            // Symmetric probabilities land on paired states (the table
+            // stores each distribution twice, odd = mps 1, even = mps 0).
+            for &p in &[0.6f32, 0.75, 0.9, 0.99] {
+                assert_eq!(primer.state(p) + 1, primer.state(1.0 - p));
+            }
+        }
+    }
+
+    #[test]
+    fn prime_matches_per_element_state_and_clone_copies() {
+        let primer = StatePrimer::new(false);
+        // Deterministic spread of probabilities across both chains.
+        let probs: Vec<f32> = (0..300)
+            .map(|i| {
+                let mut x = (i as u64).wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+                x ^= x >> 33;
+                (x % 9998 + 1) as f32 / 10000.0
+            })
+            .collect();
+
+        let mut bulk = vec![0 as BitContext; probs.len()];
+        primer.prime(&mut bulk, &probs);
+        for (i, &p) in probs.iter().enumerate() {
+            assert_eq!(bulk[i], primer.state(p), "prob {p}");
+        }
+
+        let mut copy = vec![0 as BitContext; bulk.len()];
+        clone_trained(&mut copy, &bulk);
+        assert_eq!(copy, bulk);
+    }
+}
@@ -1,5 +1,12 @@
 /// Z-Coder probability table entry
-#[derive(Debug, Copy, Clone)]
+///
+/// One entry is everything the coder reads for a context: interleaving the
+/// four fields keeps a coded bit to a single cache line, where split
+/// p/m/up/dn arrays would touch up to three. The 8-byte alignment pads the
+/// 6-byte record to a power-of-two slot so no entry straddles a line and
+/// indexing is a shift instead of a multiply.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+#[repr(C, align(8))]
 pub struct ZpTableEntry {
     pub p: u16, // Probability value (16-bit)
     pub m: u16, // Threshold for MPS adaptation
@@ -300,3 +307,33 @@ pub const DEFAULT_ZP_TABLE: [ZpTableEntry; 256] = zp_table_c!(
   { 0x0000,  0x0000,   0,   0 },
   { 0x0000,  0x0000,   0,   0 },
 );
+
+/// Adaptation table with the `dn` patch for non-compat mode applied at
+/// compile time.
+///
+/// `ZEncoder::new(_, false)` used to copy `DEFAULT_ZP_TABLE` and run this
+/// patch loop on every construction; evaluating it once in a `const fn`
+/// lets all encoder instances share one static 2 KB table.
+pub static PATCHED_ZP_TABLE: [ZpTableEntry; 256] = build_patched_table();
+
+/// The default table as a static, so compat-mode encoders can borrow it
+/// with a `'static` lifetime instead of holding a per-instance copy.
+pub static COMPAT_ZP_TABLE: [ZpTableEntry; 256] = DEFAULT_ZP_TABLE;
+
+const fn build_patched_table() -> [ZpTableEntry; 256] {
+    let mut table = DEFAULT_ZP_TABLE;
+    let mut j = 0;
+    while j < 256 {
+        let mut a: u32 = 0x10000 - table[j].p as u32;
+        while a >= 0x8000 {
+            a = (a << 1) & 0xffff;
+        }
+        if table[j].m > 0 && a + table[j].p as u32 >= 0x8000 && a >= table[j].m as u32 {
+            let x = DEFAULT_ZP_TABLE[j].dn;
+            let y = DEFAULT_ZP_TABLE[x as usize].dn;
+            table[j].dn = y;
+        }
+        j += 1;
+    }
+    table
+}
@@ -1,5 +1,5 @@
 use super::ZpEncoderCursor;
-use super::table::{DEFAULT_ZP_TABLE, ZpTableEntry};
+use super::table::{COMPAT_ZP_TABLE, PATCHED_ZP_TABLE, ZpTableEntry};
 use std::io::Cursor;
 use std::io::Write;
 use thiserror::Error;
@@ -31,66 +31,158 @@ impl From<ZCodecError> for std::io::Error {
     }
 }
 
+/// Size of the internal output block: completed bytes are staged here and
+/// handed to the writer in one `write_all` instead of one call per byte.
+const OUT_BLOCK: usize = 64 * 1024;
+
 /// An adaptive quasi-arithmetic encoder implementing the ZP-Coder algorithm.
 pub struct ZEncoder<W: Write> {
     writer: Option<W>,
+    outbuf: Vec<u8>, // block buffer between outbit() and the writer
     // Core ZP-Coder registers (matching djvulibre exactly)
     a: u32,      // range register (unsigned!)
     subend: u32, // subinterval end
     buffer: u32, // 3-byte bit buffer (24-bit)
     nrun: u32,   // run of pending bits
-    byte: u8,    // current output byte
-    scount: i32, // bit counter in current byte
+    bitreg: u64, // 64-bit output shift register
+    scount: i32, // bit count in bitreg
     delay: i32,  // delay counter
     finished: bool,
-    table: [ZpTableEntry; 256], // mutable table for patching
+    // Shared static adaptation table: both variants are built at compile
+    // time, so construction neither copies nor patches 256 entries.
+    table: &'static [ZpTableEntry; 256],
+    // Always-on rate accounting (replaces upstream's opt-in
+    // ZPCODEC_BITCOUNT build): every bit handed to zemit() is counted
+    // against the caller-selected bucket. Two u64 increments per coded
+    // output bit, so it stays enabled in release builds.
+    bitcount: u64,
+    bucket: usize,
+    bucket_bits: Vec<u64>,
+}
+
+/// Plain-data snapshot of the complete ZP encoder register state.
+///
+/// Captured by [`ZEncoder::snapshot`] and reinstalled by
+/// [`ZEncoder::restore`]. Bit contexts are not included because this port
+/// keeps them caller-owned (`&mut BitContext` per call), so the caller
+/// snapshots its own context arrays alongside.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ZpCheckpoint {
+    a: u32,
+    subend: u32,
+    buffer: u32,
+    nrun: u32,
+    bitreg: u64,
+    scount: i32,
+    delay: i32,
+    finished: bool,
+    djvu_compat: bool,
+}
+
+/// Picks the compile-time table for the requested compatibility mode.
+pub(super) fn select_table(djvu_compat: bool) -> &'static [ZpTableEntry; 256] {
+    if djvu_compat {
+        &COMPAT_ZP_TABLE
+    } else {
+        &PATCHED_ZP_TABLE
+    }
 }
 
 impl<W: Write> ZEncoder<W> {
     /// Creates a new ZP-Coder encoder that writes to the given writer.
     pub fn new(writer: W, djvu_compat: bool) -> Result<Self, ZCodecError> {
-        // Create a 256-entry table, starting with the default 251 entries
-        let mut table = [ZpTableEntry {
-            p: 0,
-            m: 0,
-            up: 0,
-            dn: 0,
-        }; 256];
-
-        // Copy the default table entries
-        for (i, &entry) in DEFAULT_ZP_TABLE.iter().enumerate() {
-            table[i] = entry;
-        }
-
-        // Patch table when djvu_compat is false
-        if !djvu_compat {
-            for j in 0..256 {
-                let mut a = 0x10000 - table[j].p as u32;
-                while a >= 0x8000 {
-                    a = (a << 1) & 0xffff;
-                }
-                if table[j].m > 0 && a + table[j].p as u32 >= 0x8000 && a >= table[j].m as u32 {
-                    let x = DEFAULT_ZP_TABLE[j].dn;
-                    let y = DEFAULT_ZP_TABLE[x as usize].dn;
-                    table[j].dn = y;
-                }
-            }
-        }
+        Self::with_table(writer, select_table(djvu_compat))
+    }
+
+    /// Compile-time variant of [`new`](Self::new) for call sites whose
+    /// compatibility mode is fixed (in this codebase, all of them): the
+    /// table reference is chosen at monomorphization time, so the selection
+    /// branch folds away and the constructor is a plain field init.
+    pub fn new_const<const DJVU_COMPAT: bool>(writer: W) -> Result<Self, ZCodecError> {
+        let table: &'static [ZpTableEntry; 256] = if DJVU_COMPAT {
+            &COMPAT_ZP_TABLE
+        } else {
+            &PATCHED_ZP_TABLE
+        };
+        Self::with_table(writer, table)
+    }
 
+    fn with_table(writer: W, table: &'static [ZpTableEntry; 256]) -> Result<Self, ZCodecError> {
         Ok(ZEncoder {
             writer: Some(writer),
+            outbuf: Vec::with_capacity(OUT_BLOCK),
             a: 0,             // Initialize to 0 as per DjVuLibre
             subend: 0,        // Subinterval end starts at 0
             buffer: 0xffffff, // 3-byte buffer initialized to all 1s
             nrun: 0,          // Run counter starts at 0
-            byte: 0,          // Current byte starts at 0
+            bitreg: 0,        // Output shift register starts empty
             scount: 0,        // Bit count starts at 0
             delay: 25,        // Delay starts at 25
             finished: false,
             table,
+            bitcount: 0,
+            bucket: 0,
+            bucket_bits: vec![0],
         })
     }
 
+    /// Routes the accounting of subsequently coded bits to bucket `id`,
+    /// growing the bucket table on first use. Callers assign one id per
+    /// document component (mask, background, text, ...) to attribute the
+    /// output rate without an instrumented build.
+    pub fn set_accounting_bucket(&mut self, id: usize) {
+        if id >= self.bucket_bits.len() {
+            self.bucket_bits.resize(id + 1, 0);
+        }
+        self.bucket = id;
+    }
+
+    /// Total bits emitted into the arithmetic stream so far, across all
+    /// buckets. Cumulative over [`reset`](Self::reset) so a reused encoder
+    /// keeps whole-document totals.
+    pub fn tell_bits(&self) -> u64 {
+        self.bitcount
+    }
+
+    /// Bits attributed to bucket `id`; zero for buckets never selected.
+    pub fn bucket_bits(&self, id: usize) -> u64 {
+        self.bucket_bits.get(id).copied().unwrap_or(0)
+    }
+
+    /// Terminates the ZP bitstream and hands all pending bytes to the writer.
+    ///
+    /// Unlike [`finish`](Self::finish) this keeps the encoder object alive so
+    /// it can be rearmed with [`reset`](Self::reset); further `encode` calls
+    /// before a reset return [`ZCodecError::Finished`].
+    pub fn flush(&mut self) -> Result<(), ZCodecError> {
+        if !self.finished {
+            self.eflush()?;
+            self.finished = true;
+        }
+        Ok(())
+    }
+
+    /// Rearms the encoder for a new chunk, reusing the adaptation table.
+    ///
+    /// Flushes any unfinished stream first, then restores the start-of-stream
+    /// register state and installs `writer` for the next chunk; the previous
+    /// writer is returned. The adaptation tables are shared statics, so one
+    /// encoder can be reused across thousands of chunks at no table cost.
+    pub fn reset(&mut self, writer: W, djvu_compat: bool) -> Result<Option<W>, ZCodecError> {
+        self.flush()?;
+        self.table = select_table(djvu_compat);
+        let old = self.writer.replace(writer);
+        self.a = 0;
+        self.subend = 0;
+        self.buffer = 0xffffff;
+        self.nrun = 0;
+        self.bitreg = 0;
+        self.scount = 0;
+        self.delay = 25;
+        self.finished = false;
+        Ok(old)
+    }
+
     /// Encodes a single bit using the provided statistical context.
     #[inline(always)]
     pub fn encode(&mut self, bit: bool, ctx: &mut BitContext) -> Result<(), ZCodecError> {
@@ -114,6 +206,51 @@ impl<W: Write> ZEncoder<W> {
         Ok(())
     }
 
+    /// Encodes two adaptive bits per call, picking the second context from
+    /// the first bit's value (`c1a` when `b0` is false, `c1b` otherwise) —
+    /// the encoder mirror of the decoder's two-bit fence shortcut.
+    ///
+    /// When both bits ride the MPS no-renormalization path, the whole call
+    /// is two table adds on a register-resident `a`: one `finished` guard,
+    /// no emission, no context update. Either bit needing the LPS or
+    /// renormalizing MPS route falls back to the general routines for that
+    /// bit alone, so the stream is bit-identical to two `encode` calls.
+    /// High-skew JB2 regions keep both bits on the fast path most of the
+    /// time, halving the per-bit call overhead there.
+    #[inline(always)]
+    pub fn encode2(
+        &mut self,
+        b0: bool,
+        c0: &mut BitContext,
+        b1: bool,
+        c1a: &mut BitContext,
+        c1b: &mut BitContext,
+    ) -> Result<(), ZCodecError> {
+        if self.finished {
+            return Err(ZCodecError::Finished);
+        }
+
+        let z0 = self.a + self.table[*c0 as usize].p as u32;
+        if b0 == (*c0 & 1 != 0) && z0 < 0x8000 {
+            self.a = z0;
+        } else if b0 != (*c0 & 1 != 0) {
+            self.encode_lps(c0, z0)?;
+        } else {
+            self.encode_mps(c0, z0)?;
+        }
+
+        let c1 = if b0 { c1b } else { c1a };
+        let z1 = self.a + self.table[*c1 as usize].p as u32;
+        if b1 == (*c1 & 1 != 0) && z1 < 0x8000 {
+            self.a = z1;
+            Ok(())
+        } else if b1 != (*c1 & 1 != 0) {
+            self.encode_lps(c1, z1)
+        } else {
+            self.encode_mps(c1, z1)
+        }
+    }
+
     /// Encodes a bit without compression (pass-thru encoder).
     ///
     /// Matches DjVuLibre `ZPCodec::encoder(int bit)`:
@@ -129,6 +266,12 @@ impl<W: Write> ZEncoder<W> {
             return Err(ZCodecError::Finished);
         }
 
+        self.encode_raw_step(bit)
+    }
+
+    /// One pass-thru coding step without the `finished` guard.
+    #[inline(always)]
+    fn encode_raw_step(&mut self, bit: bool) -> Result<(), ZCodecError> {
         // CRITICAL: Match C++ formula exactly: z = 0x8000 + ((a+a+a) >> 3)
         // This gives z = 0x8000 + 3*a/8, NOT 0x8000 + a/2
         let z = 0x8000u32 + ((self.a + self.a + self.a) >> 3);
@@ -139,6 +282,44 @@ impl<W: Write> ZEncoder<W> {
         }
     }
 
+    /// Encodes a run of significance bits through the pass-thru coder.
+    ///
+    /// Equivalent to calling [`iwencoder`] once per bit but with the
+    /// `finished` guard hoisted out of the loop, so the interval registers
+    /// stay live across the whole run. IW44 bucket coding issues these bits
+    /// in bursts of dozens, where the per-call guard and state spills are
+    /// measurable.
+    ///
+    /// [`iwencoder`]: Self::iwencoder
+    pub fn iwencode_run(&mut self, bits: &[bool]) -> Result<(), ZCodecError> {
+        if self.finished {
+            return Err(ZCodecError::Finished);
+        }
+        for &bit in bits {
+            self.encode_raw_step(bit)?;
+        }
+        Ok(())
+    }
+
+    /// Encodes the low `n` bits of `value` MSB-first through the pass-thru
+    /// coder.
+    ///
+    /// Equivalent to `n` calls of [`encode_raw`](Self::encode_raw) but with
+    /// the stream-state guard hoisted out of the loop, for the fixed-width
+    /// literal fields that BZZ headers and the number coders emit.
+    pub fn encode_bits(&mut self, value: u32, n: u32) -> Result<(), ZCodecError> {
+        debug_assert!(n <= 32);
+        if self.finished {
+            return Err(ZCodecError::Finished);
+        }
+        let mut shift = n;
+        while shift > 0 {
+            shift -= 1;
+            self.encode_raw_step((value >> shift) & 1 != 0)?;
+        }
+        Ok(())
+    }
+
     #[inline(always)]
     fn encode_mps(&mut self, ctx: &mut BitContext, mut z: u32) -> Result<(), ZCodecError> {
         let d = 0x6000 + ((z + self.a) >> 2);
@@ -167,10 +348,36 @@ impl<W: Write> ZEncoder<W> {
         z = 0x10000 - z;
         self.subend = self.subend.wrapping_add(z);
         self.a = self.a.wrapping_add(z);
-        while self.a >= 0x8000 {
-            self.zemit(1 - ((self.subend >> 15) as i32))?;
-            self.subend = (self.subend << 1) as u16 as u32;
-            self.a = (self.a << 1) as u16 as u32;
+        self.renormalize()
+    }
+
+    /// LPS renormalization with the shift count taken from one `lzcnt`.
+    ///
+    /// The first step keeps the historical arithmetic because `a` and
+    /// `subend` may still carry a 17th bit from the interval addition.
+    /// Once both are reduced to 16 bits, the remaining iteration count of
+    /// the old `while a >= 0x8000` loop is exactly the number of leading
+    /// one bits of `a`, so it is computed in a single `leading_zeros`
+    /// (hardware lzcnt/clz) and `a`/`subend` take their whole multi-bit
+    /// shift in one step; `zemit` still sees every carry-delayed bit.
+    #[inline(always)]
+    fn renormalize(&mut self) -> Result<(), ZCodecError> {
+        if self.a < 0x8000 {
+            return Ok(());
+        }
+        self.zemit(1 - ((self.subend >> 15) as i32))?;
+        self.subend = (self.subend << 1) as u16 as u32;
+        self.a = (self.a << 1) as u16 as u32;
+
+        let n = (!(self.a as u16)).leading_zeros();
+        if n > 0 {
+            let mut s = self.subend;
+            for _ in 0..n {
+                self.zemit(1 - ((s >> 15) as i32))?;
+                s = (s << 1) & 0xffff;
+            }
+            self.subend = ((self.subend << n) as u16) as u32;
+            self.a = ((self.a << n) as u16) as u32;
         }
         Ok(())
     }
@@ -191,16 +398,13 @@ impl<W: Write> ZEncoder<W> {
         z = 0x10000 - z;
         self.subend = self.subend.wrapping_add(z);
         self.a = self.a.wrapping_add(z);
-        while self.a >= 0x8000 {
-            self.zemit(1 - ((self.subend >> 15) as i32))?;
-            self.subend = (self.subend << 1) as u16 as u32;
-            self.a = (self.a << 1) as u16 as u32;
-        }
-        Ok(())
+        self.renormalize()
     }
 
     #[inline(always)]
     fn zemit(&mut self, bit: i32) -> Result<(), ZCodecError> {
+        self.bitcount += 1;
+        self.bucket_bits[self.bucket] += 1;
         self.buffer = (self.buffer << 1).wrapping_add(bit as u32);
         let b = (self.buffer >> 24) as u8;
         self.buffer &= 0x00ff_ffff;
@@ -208,18 +412,14 @@ impl<W: Write> ZEncoder<W> {
         match b {
             1 => {
                 self.outbit(1)?;
-                while self.nrun > 0 {
-                    self.outbit(0)?;
-                    self.nrun -= 1;
-                }
+                let run = self.nrun;
+                self.outbit_run(0, run)?;
                 self.nrun = 0;
             }
             0xff => {
                 self.outbit(0)?;
-                while self.nrun > 0 {
-                    self.outbit(1)?;
-                    self.nrun -= 1;
-                }
+                let run = self.nrun;
+                self.outbit_run(1, run)?;
                 self.nrun = 0;
             }
             0 => {
@@ -242,15 +442,68 @@ impl<W: Write> ZEncoder<W> {
                 self.delay -= 1;
             }
         } else {
-            self.byte = (self.byte << 1) | (bit & 1);
+            self.bitreg = (self.bitreg << 1) | (bit & 1) as u64;
             self.scount += 1;
-            if self.scount == 8 {
-                if let Some(ref mut writer) = self.writer {
-                    writer.write_all(&[self.byte])?;
-                }
-                self.scount = 0;
-                self.byte = 0;
+            if self.scount == 64 {
+                self.spill_bitreg()?;
+            }
+        }
+        Ok(())
+    }
+
+    /// Appends `count` copies of `bit`, filling the shift register by whole
+    /// chunks instead of one call per bit. Used for the `nrun` carry runs in
+    /// `zemit`, which can span hundreds of identical bits.
+    fn outbit_run(&mut self, bit: u8, mut count: u32) -> Result<(), ZCodecError> {
+        // The delay window is consumed bit by bit; it only covers the first
+        // 25 output bits so this loop is cold.
+        while self.delay > 0 && count > 0 {
+            self.outbit(bit)?;
+            count -= 1;
+        }
+        while count > 0 {
+            let k = (64 - self.scount as u32).min(count);
+            let pattern = if bit & 1 == 0 {
+                0
+            } else if k == 64 {
+                u64::MAX
+            } else {
+                (1u64 << k) - 1
+            };
+            self.bitreg = if k == 64 { 0 } else { self.bitreg << k } | pattern;
+            self.scount += k as i32;
+            count -= k;
+            if self.scount == 64 {
+                self.spill_bitreg()?;
+            }
+        }
+        Ok(())
+    }
+
+    /// Moves whole bytes out of the shift register into the output block.
+    /// `scount` must be a multiple of 8.
+    fn spill_bitreg(&mut self) -> Result<(), ZCodecError> {
+        debug_assert!(self.scount % 8 == 0);
+        let mut n = self.scount;
+        while n > 0 {
+            n -= 8;
+            self.outbuf.push((self.bitreg >> n) as u8);
+        }
+        if self.outbuf.len() >= OUT_BLOCK {
+            self.flush_block()?;
+        }
+        self.scount = 0;
+        self.bitreg = 0;
+        Ok(())
+    }
+
+    /// Hands the staged output block to the writer in a single call.
+    fn flush_block(&mut self) -> Result<(), ZCodecError> {
+        if !self.outbuf.is_empty() {
+            if let Some(ref mut writer) = self.writer {
+                writer.write_all(&self.outbuf)?;
             }
+            self.outbuf.clear();
         }
         Ok(())
     }
@@ -266,15 +519,17 @@ impl<W: Write> ZEncoder<W> {
             self.subend = (self.subend << 1) as u16 as u32;
         }
         self.outbit(1)?;
-        while self.nrun > 0 {
-            self.outbit(0)?;
-            self.nrun -= 1;
-        }
+        let run = self.nrun;
+        self.outbit_run(0, run)?;
         self.nrun = 0;
-        while self.scount > 0 {
+        // Pad the current byte with ones, then spill whatever whole bytes
+        // remain in the shift register.
+        while self.scount % 8 != 0 {
             self.outbit(1)?;
         }
+        self.spill_bitreg()?;
         self.delay = 0xff;
+        self.flush_block()?;
         Ok(())
     }
 
@@ -407,6 +662,68 @@ impl<W: Write> ZEncoder<W> {
         self.writer.take().ok_or(ZCodecError::Finished)
     }
 
+    /// Captures the complete coder state in a POD struct.
+    ///
+    /// Staged output bytes are handed to the writer first, so after this
+    /// call the byte stream produced so far lives entirely in the writer;
+    /// a caller doing speculative encoding records the writer position next
+    /// to the checkpoint and rewinds both together.
+    pub fn snapshot(&mut self) -> Result<ZpCheckpoint, ZCodecError> {
+        self.flush_block()?;
+        Ok(ZpCheckpoint {
+            a: self.a,
+            subend: self.subend,
+            buffer: self.buffer,
+            nrun: self.nrun,
+            bitreg: self.bitreg,
+            scount: self.scount,
+            delay: self.delay,
+            finished: self.finished,
+            djvu_compat: std::ptr::eq(self.table, &COMPAT_ZP_TABLE),
+        })
+    }
+
+    /// Reinstalls a state captured by [`snapshot`](Self::snapshot).
+    ///
+    /// Encoding resumed from here is bit-identical to encoding continued at
+    /// the snapshot point, provided the caller also restored its contexts
+    /// and rewound the writer to the recorded position.
+    pub fn restore(&mut self, cp: &ZpCheckpoint) {
+        self.a = cp.a;
+        self.subend = cp.subend;
+        self.buffer = cp.buffer;
+        self.nrun = cp.nrun;
+        self.bitreg = cp.bitreg;
+        self.scount = cp.scount;
+        self.delay = cp.delay;
+        self.finished = cp.finished;
+        self.table = select_table(cp.djvu_compat);
+        self.outbuf.clear();
+    }
+
+    /// Encodes one byte MSB-first through a 255-context binary tree.
+    ///
+    /// First-class version of the `encode_8_bits` idiom from DjVuLibre's
+    /// ZPCodec.h ("Encoding Multivalued Symbols"): the tree index starts at
+    /// 1 and each coded bit selects the next subtree via `n = (n<<1)|bit`,
+    /// so `tree[n-1]` is the context for the current decision. Keeping the
+    /// whole walk inside the codec lets the coder registers stay live across
+    /// all eight bits instead of being reloaded per call.
+    #[inline]
+    pub fn encode_byte(
+        &mut self,
+        byte: u8,
+        tree: &mut [BitContext; 255],
+    ) -> Result<(), ZCodecError> {
+        let mut n = 1usize;
+        for shift in (0..8).rev() {
+            let bit = (byte >> shift) & 1 != 0;
+            self.encode(bit, &mut tree[n - 1])?;
+            n = (n << 1) | bit as usize;
+        }
+        Ok(())
+    }
+
     /// Iwencoder for IW44 compatibility - uses fixed-probability (non-adaptive) coding.
     #[inline(always)]
     pub fn iwencoder(&mut self, bit: bool) -> Result<(), ZCodecError> {
@@ -463,6 +780,35 @@ mod tests {
         // Update expected output after verifying against C++ output
     }
 
+    #[test]
+    fn test_bit_accounting_attributes_output_to_buckets() {
+        let mut encoder = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        let mut ctx = 0;
+        assert_eq!(encoder.tell_bits(), 0);
+
+        // Bucket 1: an adaptive segment with plenty of LPS events.
+        encoder.set_accounting_bucket(1);
+        for i in 0..2000 {
+            encoder.encode(i % 3 == 0, &mut ctx).unwrap();
+        }
+        let seg1 = encoder.tell_bits();
+        assert!(seg1 > 0);
+
+        // Bucket 2: a pass-thru segment plus the flush tail.
+        encoder.set_accounting_bucket(2);
+        for i in 0..300 {
+            encoder.encode_raw(i % 2 == 0).unwrap();
+        }
+        encoder.flush().unwrap();
+
+        assert_eq!(encoder.bucket_bits(0), 0, "nothing coded before bucket 1");
+        assert_eq!(encoder.bucket_bits(1), seg1);
+        assert_eq!(encoder.bucket_bits(2), encoder.tell_bits() - seg1);
+        assert_eq!(encoder.bucket_bits(7), 0, "unselected buckets stay empty");
+        // Raw bits cost ~1 coded bit each, so bucket 2 covers its segment.
+        assert!(encoder.bucket_bits(2) >= 300);
+    }
+
     #[test]
     fn test_encode_highly_probable_sequence() {
         let mut encoder = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
@@ -476,6 +822,247 @@ mod tests {
         let data = encoder.finish().unwrap().into_inner();
         assert!(data.len() < 20);
     }
+
+    #[test]
+    fn test_renormalization_bitstream_golden() {
+        // Mixed adaptive/raw workload with an LPS-heavy context walk; the
+        // expected values were captured from the bit-at-a-time
+        // renormalization loop before it was batched.
+        let mut enc = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        let mut ctxs = [0u8; 32];
+        let mut state = 0x1234_5678u32;
+        for i in 0..5000 {
+            state = state.wrapping_mul(1664525).wrapping_add(1013904223);
+            let bit = (state >> 16) & 1 != 0;
+            if i % 3 == 0 {
+                enc.encode_raw(bit).unwrap();
+            } else {
+                let c = ((state >> 8) & 31) as usize;
+                enc.encode(bit, &mut ctxs[c]).unwrap();
+            }
+        }
+        let data = enc.finish().unwrap().into_inner();
+        let mut hash = 0xcbf29ce484222325u64;
+        for &b in &data {
+            hash = (hash ^ b as u64).wrapping_mul(0x100000001b3);
+        }
+        assert_eq!(data.len(), 640);
+        assert_eq!(hash, 0x8e59b4b4ebfc36ea);
+    }
+
+    #[test]
+    fn test_table_entry_fills_one_slot() {
+        // One context record per 8-byte slot: 128 entries per cache line
+        // pair, never straddling a line.
+        assert_eq!(std::mem::size_of::<ZpTableEntry>(), 8);
+        assert_eq!(std::mem::align_of::<ZpTableEntry>(), 8);
+    }
+
+    #[test]
+    fn test_patched_table_matches_runtime_patch() {
+        use super::super::table::DEFAULT_ZP_TABLE;
+
+        // The patch loop that ZEncoder::new used to run per instance.
+        let mut table = DEFAULT_ZP_TABLE;
+        for j in 0..256 {
+            let mut a = 0x10000 - table[j].p as u32;
+            while a >= 0x8000 {
+                a = (a << 1) & 0xffff;
+            }
+            if table[j].m > 0 && a + table[j].p as u32 >= 0x8000 && a >= table[j].m as u32 {
+                let x = DEFAULT_ZP_TABLE[j].dn;
+                let y = DEFAULT_ZP_TABLE[x as usize].dn;
+                table[j].dn = y;
+            }
+        }
+
+        assert_eq!(table, PATCHED_ZP_TABLE);
+        assert_eq!(DEFAULT_ZP_TABLE, COMPAT_ZP_TABLE);
+    }
+
+    #[test]
+    fn test_reset_matches_fresh_encoder() {
+        let encode_chunk = |enc: &mut ZEncoder<Cursor<Vec<u8>>>, seed: u8| {
+            let mut ctx = 0;
+            for i in 0..200u32 {
+                enc.encode((i as u8).wrapping_mul(seed) & 4 != 0, &mut ctx)
+                    .unwrap();
+            }
+        };
+
+        // One encoder reused across two chunks via reset().
+        let mut enc = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        encode_chunk(&mut enc, 3);
+        let first = enc
+            .reset(Cursor::new(Vec::new()), false)
+            .unwrap()
+            .unwrap()
+            .into_inner();
+        encode_chunk(&mut enc, 7);
+        let second = enc.finish().unwrap().into_inner();
+
+        // Fresh encoder per chunk as the reference.
+        for (seed, expected) in [(3u8, &first), (7u8, &second)] {
+            let mut fresh = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+            encode_chunk(&mut fresh, seed);
+            assert_eq!(&fresh.finish().unwrap().into_inner(), expected);
+        }
+    }
+
+    #[test]
+    fn test_encode_bits_matches_per_bit_raw_calls() {
+        let values = [(0u32, 1u32), (1, 1), (0xab, 8), (0x1234, 16), (123456, 24)];
+
+        let mut bulk = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        for &(v, n) in &values {
+            bulk.encode_bits(v, n).unwrap();
+        }
+        let bulk_data = bulk.finish().unwrap().into_inner();
+
+        let mut perbit = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        for &(v, n) in &values {
+            for shift in (0..n).rev() {
+                perbit.encode_raw((v >> shift) & 1 != 0).unwrap();
+            }
+        }
+        let perbit_data = perbit.finish().unwrap().into_inner();
+
+        assert_eq!(bulk_data, perbit_data);
+    }
+
+    #[test]
+    fn test_encode2_matches_per_bit_encode() {
+        // Bit pairs at several skews so all four path combinations
+        // (fast/fast, fast/slow, slow/fast, slow/slow) occur.
+        for &ones_shift in &[1u32, 3, 6] {
+            let mut state = 0xc0ffee_u64 ^ (ones_shift as u64) << 40;
+            let mut pairs = Vec::new();
+            for _ in 0..4000 {
+                state = state.wrapping_mul(6364136223846793005).wrapping_add(1);
+                let b0 = (state >> 62) >> ones_shift.min(2) == 0;
+                let b1 = (state >> (40 + ones_shift)) & 1 != 0;
+                pairs.push((b0, b1));
+            }
+
+            let mut fused = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+            let mut fc = [0u8; 3];
+            for &(b0, b1) in &pairs {
+                let [c0, c1a, c1b] = &mut fc;
+                fused.encode2(b0, c0, b1, c1a, c1b).unwrap();
+            }
+            let fused_data = fused.finish().unwrap().into_inner();
+
+            let mut plain = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+            let mut pc = [0u8; 3];
+            for &(b0, b1) in &pairs {
+                plain.encode(b0, &mut pc[0]).unwrap();
+                let c1 = if b0 { 2 } else { 1 };
+                plain.encode(b1, &mut pc[c1]).unwrap();
+            }
+            let plain_data = plain.finish().unwrap().into_inner();
+
+            assert_eq!(fused_data, plain_data, "skew shift {}", ones_shift);
+            assert_eq!(fc, pc, "contexts must adapt identically");
+        }
+    }
+
+    #[test]
+    fn test_iwencode_run_matches_per_bit_calls() {
+        // Burst sizes similar to IW44 bucket coding, with a biased bit mix.
+        let mut state = 0x9e37u64;
+        let mut runs: Vec<Vec<bool>> = Vec::new();
+        for len in [1usize, 3, 16, 47, 64] {
+            let run = (0..len)
+                .map(|_| {
+                    state = state.wrapping_mul(6364136223846793005).wrapping_add(1);
+                    (state >> 61) == 0
+                })
+                .collect();
+            runs.push(run);
+        }
+
+        let mut bulk = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        for run in &runs {
+            bulk.iwencode_run(run).unwrap();
+        }
+        let bulk_data = bulk.finish().unwrap().into_inner();
+
+        let mut perbit = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        for run in &runs {
+            for &bit in run {
+                perbit.iwencoder(bit).unwrap();
+            }
+        }
+        let perbit_data = perbit.finish().unwrap().into_inner();
+
+        assert_eq!(bulk_data, perbit_data);
+    }
+
+    #[test]
+    fn test_snapshot_restore_replays_identically() {
+        let mut enc = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        let mut ctxs = [0u8; 8];
+        for i in 0..300u32 {
+            enc.encode(i % 5 == 0, &mut ctxs[(i % 8) as usize]).unwrap();
+        }
+
+        let cp = enc.snapshot().unwrap();
+        let ctxs_cp = ctxs;
+        let mark = enc.writer.as_ref().unwrap().get_ref().len();
+
+        let continue_from = |enc: &mut ZEncoder<Cursor<Vec<u8>>>, ctxs: &mut [u8; 8]| {
+            for i in 0..300u32 {
+                enc.encode(i % 3 == 0, &mut ctxs[(i % 8) as usize]).unwrap();
+            }
+        };
+
+        continue_from(&mut enc, &mut ctxs);
+        let first = enc.snapshot().map(|_| ()).and_then(|_| {
+            Ok::<_, ZCodecError>(enc.writer.as_ref().unwrap().get_ref()[mark..].to_vec())
+        });
+
+        // Rewind coder, contexts, and writer; replay the continuation.
+        enc.restore(&cp);
+        ctxs = ctxs_cp;
+        enc.writer.as_mut().unwrap().get_mut().truncate(mark);
+        enc.writer
+            .as_mut()
+            .unwrap()
+            .set_position(mark as u64);
+        continue_from(&mut enc, &mut ctxs);
+        enc.snapshot().unwrap();
+        let second = enc.writer.as_ref().unwrap().get_ref()[mark..].to_vec();
+
+        assert_eq!(first.unwrap(), second);
+    }
+
+    #[test]
+    fn test_encode_byte_matches_bitwise_tree_walk() {
+        let payload: Vec<u8> = (0u32..512).map(|i| (i * 37 + 11) as u8).collect();
+
+        let mut enc_a = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        let mut tree_a = [0u8; 255];
+        for &b in &payload {
+            enc_a.encode_byte(b, &mut tree_a).unwrap();
+        }
+        let data_a = enc_a.finish().unwrap().into_inner();
+
+        // Same tree walk spelled out as eight encode() calls (the old idiom).
+        let mut enc_b = ZEncoder::new(Cursor::new(Vec::new()), false).unwrap();
+        let mut tree_b = [0u8; 255];
+        for &b in &payload {
+            let mut n = 1usize;
+            for shift in (0..8).rev() {
+                let bit = (b >> shift) & 1 != 0;
+                enc_b.encode(bit, &mut tree_b[n - 1]).unwrap();
+                n = (n << 1) | bit as usize;
+            }
+        }
+        let data_b = enc_b.finish().unwrap().into_inner();
+
+        assert_eq!(data_a, data_b);
+        assert_eq!(tree_a, tree_b);
+    }
 }
 
 // Implement ZpEncoderCursor trait for ZEncoder<Cursor<Vec<u8>>>
@@ -488,15 +1075,21 @@ impl ZpEncoderCursor for ZEncoder<Cursor<Vec<u8>>> {
         self.iwencoder(bit)
     }
 
+    fn iwencode_run(&mut self, bits: &[bool]) -> Result<(), ZCodecError> {
+        self.iwencode_run(bits)
+    }
+
     fn encode_raw_bit(&mut self, bit: bool) -> Result<(), ZCodecError> {
         self.encode_raw(bit)
     }
 
     fn tell_bytes(&self) -> usize {
+        // Include bytes still staged in the output block so byte-limit
+        // checks see the same counts as the old per-byte writes.
         if let Some(ref writer) = self.writer {
-            writer.get_ref().len()
+            writer.get_ref().len() + self.outbuf.len()
         } else {
-            0
+            self.outbuf.len()
         }
     }
 
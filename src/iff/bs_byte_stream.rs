@@ -26,7 +26,7 @@ pub struct BsEncoder<W: Write> {
 impl<W: Write> BsEncoder<W> {
     pub fn new(writer: W, block_size_k: usize) -> Result<Self> {
         let block_size = (block_size_k * 1024).clamp(MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
-        let zp_encoder = RustZEncoder::new(writer, true)?; // djvu_compat=true to match C++ BSByteStream
+        let zp_encoder = RustZEncoder::new_const::<true>(writer)?; // djvu_compat=true to match C++ BSByteStream
         Ok(Self {
             zp_encoder,
             buffer: Vec::with_capacity(block_size + OVERFLOW),
@@ -245,18 +245,10 @@ impl<W: Write> BsEncoder<W> {
     }
 
     /// Encodes a raw integer value with the specified number of bits.
-    /// Matches C++ encode_raw exactly: tree-based encoding using zp.encoder(b)
+    /// The C++ tree loop here reduces to plain MSB-first pass-thru coding
+    /// of the low `bits` bits, which is exactly `ZEncoder::encode_bits`.
     fn encode_raw(&mut self, bits: u8, x: u32) -> Result<()> {
-        let mut n = 1u32;
-        let m = 1u32 << bits;
-        let mut x = x;
-        while n < m {
-            x = (x & (m - 1)) << 1;
-            let b = (x >> bits) != 0;
-            // Use raw encoder (no context) - matches C++ zp.encoder(b)
-            self.zp_encoder.encode_raw(b)?;
-            n = (n << 1) | (b as u32);
-        }
+        self.zp_encoder.encode_bits(x, bits as u32)?;
         Ok(())
     }
 
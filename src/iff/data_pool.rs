@@ -102,6 +102,85 @@ impl DataSource for ArcCursor {
     }
 }
 
+// Implement DataSource for a read-only cursor over any shared byte owner.
+//
+// Unlike `ArcCursor` this does not require the data to live in a `Vec`:
+// any `AsRef<[u8]>` owner works, so callers holding e.g. a memory-mapped
+// file can hand it to a `DataPool` and have chunks read in place instead
+// of copying the mapping into an owned buffer first.
+pub struct BytesCursor {
+    owner: Arc<dyn AsRef<[u8]> + Send + Sync>,
+    pos: u64,
+    start: u64,
+    end: u64,
+}
+
+impl BytesCursor {
+    pub fn new(owner: Arc<dyn AsRef<[u8]> + Send + Sync>, start: u64, end: u64) -> Self {
+        Self {
+            owner,
+            pos: start,
+            start,
+            end,
+        }
+    }
+
+    #[inline]
+    fn data(&self) -> &[u8] {
+        (*self.owner).as_ref()
+    }
+}
+
+impl Read for BytesCursor {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        if self.pos >= self.end {
+            return Ok(0); // EOF
+        }
+        let available_data = &self.data()[self.pos as usize..self.end as usize];
+        let bytes_to_read = buf.len().min(available_data.len());
+
+        buf[..bytes_to_read].copy_from_slice(&available_data[..bytes_to_read]);
+
+        self.pos += bytes_to_read as u64;
+
+        Ok(bytes_to_read)
+    }
+}
+
+impl Seek for BytesCursor {
+    fn seek(&mut self, pos: SeekFrom) -> io::Result<u64> {
+        let current_pos_in_stream = self.pos - self.start;
+        let stream_len = self.end - self.start;
+
+        let new_pos_in_stream = match pos {
+            SeekFrom::Start(p) => p as i64,
+            SeekFrom::End(p) => stream_len as i64 + p,
+            SeekFrom::Current(p) => current_pos_in_stream as i64 + p,
+        };
+
+        if new_pos_in_stream < 0 {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "Seek to a negative position is not allowed.",
+            ));
+        }
+
+        self.pos = (self.start + new_pos_in_stream as u64).min(self.end);
+
+        Ok(self.pos - self.start)
+    }
+}
+
+impl DataSource for BytesCursor {
+    fn len(&self) -> u64 {
+        self.end - self.start
+    }
+
+    fn as_bytes(&self) -> Option<&[u8]> {
+        Some(&self.data()[self.start as usize..self.end as usize])
+    }
+}
+
 // Implement DataSource for a file.
 impl DataSource for File {
     fn len(&self) -> u64 {
@@ -147,6 +226,25 @@ impl DataPool {
         }
     }
 
+    /// Creates a new `DataPool` over any shared byte owner without copying.
+    ///
+    /// The owner only needs to expose its bytes via `AsRef<[u8]>`, so a
+    /// memory-mapped file (or any other externally managed buffer) can be
+    /// wrapped directly; reads and `with_bytes` walk the mapping in place.
+    #[inline]
+    pub fn from_bytes_owner<B>(owner: B) -> Self
+    where
+        B: AsRef<[u8]> + Send + Sync + 'static,
+    {
+        let len = owner.as_ref().len() as u64;
+        DataPool {
+            source: Arc::new(Mutex::new(BytesCursor::new(Arc::new(owner), 0, len))),
+            start: 0,
+            end: len,
+            pos: 0,
+        }
+    }
+
     /// Creates a new `DataPool` by opening a file at the given path.
     pub fn from_file<P: AsRef<Path>>(path: P) -> Result<Self> {
         let file = File::open(path)?;
@@ -310,3 +408,74 @@ impl Seek for DataPool {
         Ok(self.pos)
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn bytes_cursor_reads_within_its_window() {
+        let owner: Box<[u8]> = (0u8..10).collect();
+        // Window over bytes [2, 8): values 2..=7.
+        let mut cur = BytesCursor::new(Arc::new(owner), 2, 8);
+        assert_eq!(cur.len(), 6);
+        assert_eq!(cur.as_bytes(), Some(&[2u8, 3, 4, 5, 6, 7][..]));
+
+        let mut buf = [0u8; 4];
+        assert_eq!(cur.read(&mut buf).unwrap(), 4);
+        assert_eq!(buf, [2, 3, 4, 5]);
+        // Short read at the window boundary, then EOF.
+        assert_eq!(cur.read(&mut buf).unwrap(), 2);
+        assert_eq!(&buf[..2], &[6, 7]);
+        assert_eq!(cur.read(&mut buf).unwrap(), 0);
+    }
+
+    #[test]
+    fn bytes_cursor_seek_edge_cases() {
+        let owner: Box<[u8]> = (0u8..10).collect();
+        let mut cur = BytesCursor::new(Arc::new(owner), 2, 8);
+
+        // SeekFrom::End with a negative offset stays window-relative.
+        assert_eq!(cur.seek(SeekFrom::End(-2)).unwrap(), 4);
+        let mut buf = [0u8; 4];
+        assert_eq!(cur.read(&mut buf).unwrap(), 2);
+        assert_eq!(&buf[..2], &[6, 7]);
+
+        // Seeking past the end clamps to the window length and reads EOF.
+        assert_eq!(cur.seek(SeekFrom::Start(100)).unwrap(), 6);
+        assert_eq!(cur.read(&mut buf).unwrap(), 0);
+
+        // Seeking before the start is an error and leaves the position alone.
+        cur.seek(SeekFrom::Start(1)).unwrap();
+        assert!(cur.seek(SeekFrom::Current(-5)).is_err());
+        assert!(cur.seek(SeekFrom::End(-7)).is_err());
+        assert_eq!(cur.read(&mut buf[..1]).unwrap(), 1);
+        assert_eq!(buf[0], 3);
+    }
+
+    #[test]
+    fn from_bytes_owner_round_trips_through_data_pool() {
+        // A non-Vec owner, standing in for e.g. a memory mapping.
+        let owner: Box<[u8]> = (10u8..30).collect();
+        let expected: Vec<u8> = (10u8..30).collect();
+        let pool = DataPool::from_bytes_owner(owner);
+
+        assert_eq!(pool.len(), 20);
+        assert!(!pool.is_empty());
+        // Zero-copy access sees the full window.
+        assert_eq!(pool.with_bytes(|b| b.to_vec()), Some(expected.clone()));
+        assert_eq!(pool.to_vec().unwrap(), expected);
+
+        // Slices stay views into the same owner.
+        let slice = pool.slice(5, Some(4)).unwrap();
+        assert_eq!(slice.to_vec().unwrap(), &expected[5..9]);
+        assert!(pool.slice(15, Some(10)).is_err());
+
+        // Read/Seek walk the owner in place.
+        let mut reader = pool.clone();
+        reader.seek(SeekFrom::Start(18)).unwrap();
+        let mut tail = Vec::new();
+        reader.read_to_end(&mut tail).unwrap();
+        assert_eq!(tail, &expected[18..]);
+    }
+}